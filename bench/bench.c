@@ -0,0 +1,78 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "bench.h"
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static int compare(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static double batch_ns(bench_fn_t fn, void *arg, long count) {
+    double start = now_ns();
+    fn(arg, count);
+    return now_ns() - start;
+}
+
+void bench_run(bench_result_t *out, const char *name, bench_fn_t fn, void *arg) {
+    // double the batch until it is long enough to time, which warms up too
+    long batch = 1;
+    double start = now_ns();
+    while (batch_ns(fn, arg, batch) < BENCH_BATCH_NS) {
+        batch *= 2;
+    }
+    while (now_ns() - start < BENCH_WARMUP_NS) {
+        fn(arg, batch);
+    }
+
+    double samples[BENCH_SAMPLES];
+    for (int i = 0; i < BENCH_SAMPLES; i++) {
+        samples[i] = batch_ns(fn, arg, batch) / batch;
+    }
+    qsort(samples, BENCH_SAMPLES, sizeof(double), compare);
+
+    out->name = name;
+    out->iterations = batch * BENCH_SAMPLES;
+    out->min_ns = samples[0];
+    out->median_ns = samples[BENCH_SAMPLES / 2];
+    out->p90_ns = samples[BENCH_SAMPLES * 90 / 100];
+    out->p99_ns = samples[BENCH_SAMPLES * 99 / 100];
+}
+
+void bench_print(const bench_result_t *results, int count) {
+    printf("%-24s %10s %10s %10s %10s %10s\n", "benchmark", "ops", "min ns", "median ns", "p90 ns", "p99 ns");
+    for (int i = 0; i < count; i++) {
+        const bench_result_t *r = &results[i];
+        printf("%-24s %10ld %10.1f %10.1f %10.1f %10.1f\n",
+               r->name, r->iterations, r->min_ns, r->median_ns, r->p90_ns, r->p99_ns);
+    }
+}
+
+int bench_write_json(const char *path, const bench_result_t *results, int count) {
+    FILE *f = fopen(path, "w");
+    if (!f) {
+        perror(path);
+        return -1;
+    }
+    fprintf(f, "{\n  \"benchmarks\": [\n");
+    for (int i = 0; i < count; i++) {
+        const bench_result_t *r = &results[i];
+        fprintf(f, "    {\"name\": \"%s\", \"iterations\": %ld, \"min_ns\": %.1f, \"median_ns\": %.1f, "
+                "\"p90_ns\": %.1f, \"p99_ns\": %.1f}%s\n",
+                r->name, r->iterations, r->min_ns, r->median_ns, r->p90_ns, r->p99_ns,
+                i + 1 < count ? "," : "");
+    }
+    fprintf(f, "  ]\n}\n");
+    if (fclose(f) != 0) {
+        perror(path);
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,49 @@
+// Harness of the component microbenchmarks: warm-up, batches sized to
+// outlast the clock resolution, and percentiles of the time per operation
+
+#ifndef INCLUDE_BENCH_H
+#define INCLUDE_BENCH_H
+
+// batches timed per benchmark, after the warm-up
+#define BENCH_SAMPLES 201
+// a batch runs at least this long, in nanoseconds
+#define BENCH_BATCH_NS 1e6
+// warm-up before the first sample, in nanoseconds
+#define BENCH_WARMUP_NS 100e6
+
+// runs `count' operations of a benchmark
+typedef void (*bench_fn_t)(void *arg, long count);
+
+typedef struct {
+    const char *name;
+    // operations timed, over all samples
+    long iterations;
+    // nanoseconds per operation
+    double min_ns, median_ns, p90_ns, p99_ns;
+} bench_result_t;
+
+/**
+ * Times a benchmark: runs it until warm, then BENCH_SAMPLES batches of as
+ * many operations as take BENCH_BATCH_NS.
+ *
+ * @param out  Receives the result.
+ * @param name The name in the report, kept.
+ * @param fn   The benchmark.
+ * @param arg  Passed to `fn'.
+ */
+void bench_run(bench_result_t *out, const char *name, bench_fn_t fn, void *arg);
+
+/**
+ * Prints results as a table.
+ */
+void bench_print(const bench_result_t *results, int count);
+
+/**
+ * Writes results as JSON, one benchmark per line as bench-compare reads
+ * them.
+ *
+ * @returns 0 on success, -1 if the file cannot be written.
+ */
+int bench_write_json(const char *path, const bench_result_t *results, int count);
+
+#endif
@@ -0,0 +1,97 @@
+// Compares component benchmark results against a baseline, both as
+// written by the components benchmark, and flags the medians that got
+// slower by more than a tolerance
+//
+//   compare baseline.json results.json [tolerance-percent]
+//
+// Exits with 1 if any benchmark regressed, or has no baseline entry unless
+// BENCH_ALLOW_NEW is set in the environment.
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define RESULTS_MAX 64
+
+typedef struct {
+    char name[64];
+    double median_ns;
+} result_t;
+
+// reads "name" and "median_ns" of each line that has both
+static int load(const char *path, result_t *results) {
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        perror(path);
+        return -1;
+    }
+    int count = 0;
+    char line[512];
+    while (count < RESULTS_MAX && fgets(line, sizeof(line), f)) {
+        const char *name = strstr(line, "\"name\": \"");
+        const char *median = strstr(line, "\"median_ns\": ");
+        if (!name || !median) {
+            continue;
+        }
+        name += strlen("\"name\": \"");
+        size_t len = strcspn(name, "\"");
+        if (len >= sizeof(results[count].name)) {
+            len = sizeof(results[count].name) - 1;
+        }
+        memcpy(results[count].name, name, len);
+        results[count].name[len] = '\0';
+        results[count].median_ns = strtod(median + strlen("\"median_ns\": "), NULL);
+        count++;
+    }
+    fclose(f);
+    return count;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 3) {
+        fprintf(stderr, "usage: %s baseline.json results.json [tolerance-percent]\n", argv[0]);
+        return 2;
+    }
+    double tolerance = argc > 3 ? atof(argv[3]) : 15;
+    const char *allow_new = getenv("BENCH_ALLOW_NEW");
+    bool new_ok = allow_new && *allow_new && strcmp(allow_new, "0") != 0;
+
+    static result_t baseline[RESULTS_MAX], current[RESULTS_MAX];
+    int baseline_count = load(argv[1], baseline);
+    int current_count = load(argv[2], current);
+    if (baseline_count < 0 || current_count < 0) {
+        return 2;
+    }
+
+    int regressions = 0, unchecked = 0;
+    printf("%-24s %12s %12s %9s\n", "benchmark", "baseline ns", "median ns", "change");
+    for (int i = 0; i < current_count; i++) {
+        const result_t *now = &current[i], *then = NULL;
+        for (int j = 0; j < baseline_count && !then; j++) {
+            if (strcmp(baseline[j].name, now->name) == 0) {
+                then = &baseline[j];
+            }
+        }
+        if (!then || then->median_ns <= 0) {
+            printf("%-24s %12s %12.1f %9s\n", now->name, "-", now->median_ns, "new");
+            unchecked++;
+            continue;
+        }
+        double change = (now->median_ns / then->median_ns - 1) * 100;
+        bool regressed = change > tolerance;
+        regressions += regressed;
+        printf("%-24s %12.1f %12.1f %+8.1f%%%s\n", now->name, then->median_ns, now->median_ns, change,
+               regressed ? "  REGRESSION" : "");
+    }
+
+    if (unchecked && !new_ok) {
+        printf("%d of %d benchmarks have no baseline entry, record one with make bench-baseline "
+               "or set BENCH_ALLOW_NEW=1\n", unchecked, current_count);
+    }
+    if (regressions) {
+        printf("%d of %d benchmarks slower than the baseline by more than %g%%\n",
+               regressions, current_count, tolerance);
+    }
+    return regressions || (unchecked && !new_ok) ? 1 : 0;
+}
@@ -0,0 +1,150 @@
+// Microbenchmarks of the functions on the path of every quote, each in
+// isolation, with JSON results for bench-compare
+//
+//   components [results.json]
+
+#include <stdio.h>
+#include <string.h>
+
+#include "bench.h"
+#include "color.h"
+#include "quote.h"
+
+#ifdef CAIRO
+#include <cairo/cairo.h>
+
+#include "cairo_draw_text.h"
+#include "options.h"
+#include "stock.h"
+#include "symbols.h"
+#endif
+
+// quotes as the publisher sends them: index futures, a stock with a large
+// volume and a currency pair with five decimals
+static const char *const payloads[] = {
+    "2026-10-16 15:59:00;5010.00;5020.75;5001.5;5012.25;1234567;12.50;0.2500",
+    "2026-10-16 15:59:01;5010.00;5020.75;5001.5;5011.75;1234601;12.00;0.2400",
+    "2026-10-16 15:59:02;4391.12;4402.87;4380.05;4398.66;98765432;-3.21;-0.0729",
+    "2026-10-16 15:59:03;1.08345;1.08501;1.08211;1.08412;0;0.00067;0.0618",
+};
+#define PAYLOADS (sizeof(payloads) / sizeof(payloads[0]))
+
+static volatile size_t sink;
+
+static void bench_parse(void *arg, long count) {
+    stock_data_t *quote = arg;
+    for (long i = 0; i < count; i++) {
+        parse_stock_data(payloads[i % PAYLOADS], quote);
+        sink += quote->close.mantissa;
+    }
+}
+
+static void bench_time(void *arg, long count) {
+    (void)arg;
+    static const char *const times[] = {
+        "2026-10-16 15:59:00", "2026-10-16 15:59:01", "2026-10-16 09:30:00", "2026-03-08 02:30:00",
+    };
+    for (long i = 0; i < count; i++) {
+        sink += quote_time(times[i % 4]);
+    }
+}
+
+static void bench_color_string(void *arg, long count) {
+    (void)arg;
+    static const char *const colors[] = { "0.9-0.9-0.9-0.7", "1-0.2-0.2-0.6", "0.25-0.75-0.4-1" };
+    char buffer[32];
+    // strtok() cuts the string, so each run parses a fresh copy
+    for (long i = 0; i < count; i++) {
+        strcpy(buffer, colors[i % 3]);
+        sink += rgba_color_string(buffer).a;
+    }
+}
+
+#ifdef CAIRO
+static void bench_format(void *arg, long count) {
+    const stock_data_t *quotes = arg;
+    int slot = symbol_slot("ES1");
+    for (long i = 0; i < count; i++) {
+        current_stock_data = quotes[i % PAYLOADS];
+        current_stock_data.updated = 1;
+        draw_stock_data(slot);
+        sink += current_stock_data.title[0];
+    }
+    needs_redraw = 0;
+}
+
+static void bench_assign(void *arg, long count) {
+    (void)arg;
+    static float greens[9][3] = {
+        {  0.96862745, 0.98823529, 0.96078431 },
+        {  0.89803922, 0.96078431, 0.87843137 },
+        {  0.78039216, 0.91372549, 0.75294118 },
+        {  0.63137255, 0.85098039, 0.60784314 },
+        {  0.45490196, 0.76862745, 0.46274510 },
+        {  0.25490196, 0.67058824, 0.36470588 },
+        {  0.13725490, 0.54509804, 0.27058824 },
+        {  0.00000000, 0.42745098, 0.17254902 },
+        {  0.00000000, 0.26666667, 0.10588235 }
+    };
+    for (long i = 0; i < count; i++) {
+        sink += assign_rgb_colors((i % 9) * 0.25, greens).g * 100;
+    }
+}
+
+static void bench_change_color(void *arg, long count) {
+    (void)arg;
+    for (long i = 0; i < count; i++) {
+        sink += change_color((i % 17) * 0.25 - 2).g * 100;
+    }
+}
+
+static void bench_draw(void *arg, long count) {
+    cairo_t *cr = arg;
+    for (long i = 0; i < count; i++) {
+        draw_text(cr, 0);
+    }
+    sink += cairo_image_surface_get_data(cairo_get_target(cr))[0];
+}
+#endif
+
+int main(int argc, char *argv[]) {
+    bench_result_t results[16];
+    int count = 0;
+
+    static stock_data_t quotes[PAYLOADS];
+    for (size_t i = 0; i < PAYLOADS; i++) {
+        strcpy(quotes[i].symbol, "ES1");
+        parse_stock_data(payloads[i], &quotes[i]);
+    }
+
+    stock_data_t quote = { .symbol = "ES1" };
+    bench_run(&results[count++], "parse_stock_data", bench_parse, &quote);
+    bench_run(&results[count++], "quote_time", bench_time, NULL);
+    bench_run(&results[count++], "rgba_color_string", bench_color_string, NULL);
+
+#ifdef CAIRO
+    bench_run(&results[count++], "draw_stock_data", bench_format, quotes);
+    bench_run(&results[count++], "assign_rgb_colors", bench_assign, NULL);
+    bench_run(&results[count++], "change_color", bench_change_color, NULL);
+
+    // the overlay of the last quote at the scales of common displays
+    static const char *const draw_names[] = { "draw_text/1", "draw_text/2", "draw_text/3" };
+    for (int scale = 1; scale <= 3; scale++) {
+        options.scale = scale;
+        cairo_surface_t *surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32,
+                                                              options.overlay_width * scale,
+                                                              options.overlay_height * scale);
+        cairo_t *cr = cairo_create(surface);
+        bench_run(&results[count++], draw_names[scale - 1], bench_draw, cr);
+        cairo_destroy(cr);
+        cairo_surface_destroy(surface);
+    }
+    options.scale = 1;
+#endif
+
+    bench_print(results, count);
+    if (argc > 1 && bench_write_json(argv[1], results, count) != 0) {
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,144 @@
+// Microbenchmark of decoding a quote and formatting its overlay title,
+// with fixed-point prices against the former atof() and sprintf() path
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#define __USE_XOPEN     // for strptime
+#include <time.h>
+
+#include "price.h"
+#include "quote.h"
+
+#define ITERATIONS 200000
+
+static const char *const payloads[] = {
+    "2026-10-16 15:59:00;5010.00;5020.75;5001.5;5012.25;1234567;12.50;0.2500",
+    "2026-10-16 15:59:01;5010.00;5020.75;5001.5;5011.75;1234601;12.00;0.2400",
+    "2026-10-16 15:59:02;4391.12;4402.87;4380.05;4398.66;98765432;-3.21;-0.0729",
+    "2026-10-16 15:59:03;1.08345;1.08501;1.08211;1.08412;0;0.00067;0.0618",
+};
+#define PAYLOADS (sizeof(payloads) / sizeof(payloads[0]))
+
+// the quote record and formatting as they were before fixed point
+typedef struct {
+    char fmttime[32];
+    double time, open, high, low, close;
+    long volume;
+    double percent_change, change;
+    char symbol[16];
+    char title[64];
+    char subtitle[64];
+} legacy_data_t;
+
+static void legacy_parse(const char *data_str, legacy_data_t *d) {
+    char *data_copy = strdup(data_str);
+    int field_count = 0;
+    for (char *token = strtok(data_copy, ";"); token && field_count < 8; token = strtok(NULL, ";")) {
+        switch (field_count++) {
+            case 0: memcpy(d->fmttime, token, strlen(token)); break;
+            case 1: d->open = atof(token); break;
+            case 2: d->high = atof(token); break;
+            case 3: d->low = atof(token); break;
+            case 4: d->close = atof(token); break;
+            case 5: d->volume = atol(token); break;
+            case 6: d->change = atof(token); break;
+            case 7: d->percent_change = atof(token); break;
+        }
+    }
+    free(data_copy);
+    struct tm tm = {0};
+    strptime(d->fmttime, "%Y-%m-%d %H:%M:%S", &tm);
+    d->time = mktime(&tm);
+}
+
+static void legacy_format(legacy_data_t *d) {
+    sprintf(d->title, "%.2f %+.2f %+.3f%%", d->close, d->change, d->percent_change);
+    sprintf(d->subtitle, "%s @ %s", d->symbol, d->fmttime);
+}
+
+static volatile size_t sink;
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void report(const char *name, double seconds) {
+    printf("%-20s %8.1f ns/op\n", name, seconds / ITERATIONS * 1e9);
+}
+
+// prices whose mantissa would overflow once rescaled must be rejected, and
+// so must quotes that carry them
+static int check_range(void) {
+    static const char *const prices[] = { "123456789012345678", "99999999999.5", "-99999999999.5" };
+    int failed = 0;
+    for (int i = 0; i < 3; i++) {
+        price_t price;
+        char payload[128];
+        stock_data_t quote = { .symbol = "ES1" };
+        snprintf(payload, sizeof(payload), "2026-10-16 15:59:00;1;1;1;%s;1;0;0", prices[i]);
+        if (price_parse(prices[i], NULL, &price) == 0 || parse_stock_data(payload, &quote) == 0) {
+            printf("out of range price %s accepted\n", prices[i]);
+            failed = 1;
+        }
+    }
+    return failed;
+}
+
+int main(void) {
+    legacy_data_t legacy = { .symbol = "ES1" };
+    stock_data_t quote = { .symbol = "ES1" };
+
+    if (check_range()) {
+        return 1;
+    }
+
+    // the whole tick: decode the payload and build title and subtitle
+    double start = now();
+    for (int i = 0; i < ITERATIONS; i++) {
+        legacy_parse(payloads[i % PAYLOADS], &legacy);
+        legacy_format(&legacy);
+        sink += legacy.title[0];
+    }
+    report("tick/legacy", now() - start);
+
+    start = now();
+    for (int i = 0; i < ITERATIONS; i++) {
+        parse_stock_data(payloads[i % PAYLOADS], &quote);
+        format_quote(&quote, quote.change, quote.percent_change, 2);
+        sink += quote.title[0];
+    }
+    report("tick/fixed", now() - start);
+
+    // the prices alone, without the timestamp which both parse alike
+    const char *const prices[] = { "5012.25", "-12.50", "0.2500", "4398.66", "-0.0729", "1.08412" };
+    start = now();
+    for (int i = 0; i < ITERATIONS; i++) {
+        double close = atof(prices[i % 6]), change = atof(prices[(i + 1) % 6]), pct = atof(prices[(i + 2) % 6]);
+        sprintf(legacy.title, "%.2f %+.2f %+.3f%%", close, change, pct);
+        sink += legacy.title[0];
+    }
+    report("prices/legacy", now() - start);
+
+    start = now();
+    for (int i = 0; i < ITERATIONS; i++) {
+        price_t close, change, pct;
+        price_parse(prices[i % 6], NULL, &close);
+        price_parse(prices[(i + 1) % 6], NULL, &change);
+        price_parse(prices[(i + 2) % 6], NULL, &pct);
+        char *p = quote.title, *end = quote.title + sizeof(quote.title) - 1;
+        p = price_format(p, end, close, 2, false);
+        *p++ = ' ';
+        p = price_format(p, end, change, 2, true);
+        *p++ = ' ';
+        p = price_format(p, end, pct, 3, true);
+        *p++ = '%';
+        *p = '\0';
+        sink += quote.title[0];
+    }
+    report("prices/fixed", now() - start);
+
+    return 0;
+}
@@ -0,0 +1,110 @@
+// Latency of a quote from PUBLISH to its decoded record, over TCP loopback
+// and over a Unix domain socket to the same Redis server
+//
+//   redis_latency [host [port [socket [count]]]]
+//
+// Needs a running server listening on both, e.g. started with
+// `redis-server --unixsocket /tmp/redis.sock --unixsocketperm 700'.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <hiredis/hiredis.h>
+
+#include "quote.h"
+
+#define CHANNEL "almm-latency"
+#define RECORD "2026-10-16 15:59:00;5010.00;5020.75;5001.5;5012.25;1234567;12.50;0.2500"
+
+static double now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static int compare(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static redisContext *connect_to(const char *host, int port, const char *socket) {
+    struct timeval timeout = { 1, 500000 };
+    redisContext *c = socket ? redisConnectUnixWithTimeout(socket, timeout)
+                             : redisConnectWithTimeout(host, port, timeout);
+    if (!c || c->err) {
+        printf("%-6s cannot connect: %s\n", socket ? "unix" : "tcp", c ? c->errstr : "out of memory");
+        if (c) {
+            redisFree(c);
+        }
+        return NULL;
+    }
+    return c;
+}
+
+// The publisher writes the command without waiting for its reply, the
+// subscriber reads the message as the monitor does and decodes it
+static void measure(const char *name, const char *host, int port, const char *socket, int count) {
+    redisContext *sub = connect_to(host, port, socket);
+    redisContext *pub = connect_to(host, port, socket);
+    if (!sub || !pub) {
+        if (sub) redisFree(sub);
+        if (pub) redisFree(pub);
+        return;
+    }
+
+    redisReply *reply = redisCommand(sub, "SUBSCRIBE %s", CHANNEL);
+    freeReplyObject(reply);
+
+    double *samples = malloc(count * sizeof(double));
+    if (!samples) {
+        redisFree(sub);
+        redisFree(pub);
+        return;
+    }
+    stock_data_t quote = { .symbol = "ES1" };
+    int done = 0;
+    for (int i = 0; i < count; i++) {
+        double start = now_us();
+        redisAppendCommand(pub, "PUBLISH %s %s", CHANNEL, RECORD);
+        int written = 0;
+        while (!written && redisBufferWrite(pub, &written) == REDIS_OK) {
+        }
+
+        if (redisGetReply(sub, (void **)&reply) != REDIS_OK) {
+            printf("%-6s read error: %s\n", name, sub->errstr);
+            break;
+        }
+        if (reply->type == REDIS_REPLY_ARRAY && reply->elements == 3) {
+            parse_stock_data(reply->element[2]->str, &quote);
+        }
+        samples[done++] = now_us() - start;
+        freeReplyObject(reply);
+
+        // the PUBLISH reply, off the measured path
+        if (redisGetReply(pub, (void **)&reply) == REDIS_OK) {
+            freeReplyObject(reply);
+        }
+    }
+
+    if (done > 0) {
+        qsort(samples, done, sizeof(double), compare);
+        printf("%-6s %6d quotes  min %7.1f us  median %7.1f us  p99 %7.1f us  max %7.1f us\n", name, done,
+               samples[0], samples[done / 2], samples[done * 99 / 100], samples[done - 1]);
+    }
+    free(samples);
+    redisFree(sub);
+    redisFree(pub);
+}
+
+int main(int argc, char *argv[]) {
+    const char *host = argc > 1 ? argv[1] : "127.0.0.1";
+    int port = argc > 2 ? atoi(argv[2]) : 6379;
+    const char *socket = argc > 3 ? argv[3] : "/tmp/redis.sock";
+    int count = argc > 4 ? atoi(argv[4]) : 20000;
+
+    measure("tcp", host, port, NULL, count);
+    measure("unix", host, port, socket, count);
+    return 0;
+}
@@ -5,6 +5,7 @@
 #include "i18n.h"
 #include "options.h"
 #include "log.h"
+#include "startup.h"
 
 #ifdef GDI
   #include <windows.h>
@@ -19,21 +20,33 @@
   #include "x11/x11.h"
 #endif
 
+#ifdef CAIRO
+  #include "control.h"
+#endif
+
 #if !defined(WAYLAND) && !defined(X11) && !defined(GDI)
   #error "One of Wayland, X11 or GDI backend must be enabled."
 #endif
 
 int main(int argc, char *const argv[]) {
+  startup_trace_begin();
   // options with their default values are in global variable `options'
   i18n_set_info(NULL);
   parse_options(argc, argv);
+  startup_trace("options parsed");
+
+#ifdef CAIRO
+  if (options.control_command) {
+    exit(control_command(options.control_command));
+  }
+#endif
 
   if (options.kill_running) {
     __info__("Killing running instances\n");
-#ifdef WAYLAND
+    // both backends ask the same control socket, once is enough
+#if defined(WAYLAND)
     wayland_backend_kill_running();
-#endif
-#ifdef X11
+#elif defined(X11)
     x11_backend_kill_running();
 #endif
 #ifdef GDI
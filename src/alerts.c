@@ -0,0 +1,376 @@
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "alerts.h"
+#include "log.h"
+
+#define CROSS_UP 1
+#define CROSS_DOWN 2
+
+// the values thresholds are compared against
+typedef enum {
+  KEY_PRICE,
+  KEY_PERCENT,
+  KEY_MOVE,
+} alert_key_t;
+
+typedef struct {
+  double value;
+  // CROSS_UP and/or CROSS_DOWN, the ways of reaching `value' that fire
+  int cross;
+  int rule;
+} alert_threshold_t;
+
+// the thresholds on one value of a symbol, sorted
+typedef struct {
+  alert_key_t key;
+  // window of KEY_MOVE
+  int minutes;
+  alert_threshold_t *thresholds;
+  int count;
+  // the value at the previous quote
+  double last;
+  bool primed;
+} alert_index_t;
+
+typedef struct {
+  char symbol[SYMBOL_NAME_LEN];
+  alert_index_t *indexes;
+  int index_count;
+
+  // the last price of each minute, as far back as the longest move window
+  double *closes;
+  int ring;
+  long minute;
+  long first_minute;
+  double price;
+} alert_book_t;
+
+// during the build: one threshold and where it goes
+typedef struct {
+  const char *symbol;
+  alert_key_t key;
+  int minutes;
+  alert_threshold_t threshold;
+} alert_entry_t;
+
+static const char *const kind_names[] = {
+  "above", "below", "crosses", "change-above", "change-below", "move"
+};
+
+// the rule set, books sorted by symbol
+static alert_rule_t *rules = NULL;
+static alert_book_t *books = NULL;
+static int book_count = 0;
+static alert_index_t *indexes = NULL;
+static alert_threshold_t *thresholds = NULL;
+static double *closes = NULL;
+
+// the book of each slot, looked up again once `version' moved on; this
+// keeps symbols with rules out of the symbol table until they are quoted
+static alert_book_t *slot_books[SYMBOLS_MAX];
+static unsigned slot_versions[SYMBOLS_MAX];
+static unsigned version = 1;
+
+// quote time until which a symbol is highlighted
+static double until[SYMBOLS_MAX];
+
+static alerts_stats_t stats = {0};
+static double ns_total = 0;
+
+static int compare_entries(const void *a, const void *b) {
+  const alert_entry_t *x = a, *y = b;
+  int c = strcmp(x->symbol, y->symbol);
+  if (c != 0) {
+    return c;
+  }
+  if (x->key != y->key) {
+    return x->key < y->key ? -1 : 1;
+  }
+  if (x->minutes != y->minutes) {
+    return x->minutes < y->minutes ? -1 : 1;
+  }
+  if (x->threshold.value != y->threshold.value) {
+    return x->threshold.value < y->threshold.value ? -1 : 1;
+  }
+  return 0;
+}
+
+static int compare_books(const void *key, const void *book) {
+  return strcmp(key, ((const alert_book_t *)book)->symbol);
+}
+
+// turns a rule into its thresholds, returns how many
+static int rule_entries(const alert_rule_t *r, int rule, alert_entry_t *out) {
+  alert_entry_t e = {r->symbol, KEY_PRICE, 0, {r->threshold, 0, rule}};
+  switch (r->kind) {
+    case ALERT_ABOVE: e.threshold.cross = CROSS_UP; break;
+    case ALERT_BELOW: e.threshold.cross = CROSS_DOWN; break;
+    case ALERT_CROSSES: e.threshold.cross = CROSS_UP | CROSS_DOWN; break;
+    case ALERT_CHANGE_ABOVE: e.key = KEY_PERCENT; e.threshold.cross = CROSS_UP; break;
+    case ALERT_CHANGE_BELOW: e.key = KEY_PERCENT; e.threshold.cross = CROSS_DOWN; break;
+    case ALERT_MOVE: {
+      if (r->minutes < 1 || r->minutes > ALERT_MOVE_MINUTES) {
+        return 0;
+      }
+      double size = r->threshold < 0 ? -r->threshold : r->threshold;
+      e.key = KEY_MOVE;
+      e.minutes = r->minutes;
+      e.threshold.value = size;
+      e.threshold.cross = CROSS_UP;
+      out[0] = e;
+      e.threshold.value = -size;
+      e.threshold.cross = CROSS_DOWN;
+      out[1] = e;
+      return 2;
+    }
+    default: return 0;
+  }
+  out[0] = e;
+  return 1;
+}
+
+int alerts_set(const alert_rule_t *const new_rules, int count) {
+  alert_rule_t *r = malloc((count > 0 ? count : 1) * sizeof(alert_rule_t));
+  alert_entry_t *entries = malloc((count > 0 ? 2 * count : 1) * sizeof(alert_entry_t));
+  if (!r || !entries) {
+    free(r);
+    free(entries);
+    __error__("Cannot allocate %d alert rules\n", count);
+    return -1;
+  }
+  if (count > 0) {
+    memcpy(r, new_rules, count * sizeof(alert_rule_t));
+  }
+
+  int entry_count = 0;
+  for (int i = 0; i < count; i++) {
+    r[i].symbol[SYMBOL_NAME_LEN - 1] = '\0';
+    entry_count += rule_entries(&r[i], i, entries + entry_count);
+  }
+  qsort(entries, entry_count, sizeof(alert_entry_t), compare_entries);
+
+  // sizes of the books, their indexes and minute rings
+  int b_count = 0, i_count = 0, c_count = 0;
+  for (int i = 0; i < entry_count; i++) {
+    const alert_entry_t *e = &entries[i], *prev = i > 0 ? &entries[i - 1] : NULL;
+    bool new_book = !prev || strcmp(prev->symbol, e->symbol) != 0;
+    b_count += new_book;
+    i_count += new_book || prev->key != e->key || prev->minutes != e->minutes;
+    // the windows are sorted, the last of a book is its longest
+    bool last_of_book = i + 1 == entry_count || strcmp(entries[i + 1].symbol, e->symbol) != 0;
+    if (last_of_book && e->key == KEY_MOVE) {
+      c_count += e->minutes + 1;
+    }
+  }
+
+  alert_book_t *b = malloc((b_count > 0 ? b_count : 1) * sizeof(alert_book_t));
+  alert_index_t *x = malloc((i_count > 0 ? i_count : 1) * sizeof(alert_index_t));
+  alert_threshold_t *t = malloc((entry_count > 0 ? entry_count : 1) * sizeof(alert_threshold_t));
+  double *c = malloc((c_count > 0 ? c_count : 1) * sizeof(double));
+  if (!b || !x || !t || !c) {
+    free(b);
+    free(x);
+    free(t);
+    free(c);
+    free(r);
+    free(entries);
+    __error__("Cannot allocate the index of %d alert rules\n", count);
+    return -1;
+  }
+
+  alert_book_t *book = NULL;
+  alert_index_t *index = NULL;
+  double *ring = c;
+  for (int i = 0; i < entry_count; i++) {
+    const alert_entry_t *e = &entries[i];
+    if (!book || strcmp(book->symbol, e->symbol) != 0) {
+      book = &b[book ? book - b + 1 : 0];
+      memset(book, 0, sizeof(*book));
+      strcpy(book->symbol, e->symbol);
+      book->indexes = index ? index + 1 : x;
+      index = NULL;
+    }
+    if (!index || index->key != e->key || index->minutes != e->minutes) {
+      index = &book->indexes[book->index_count++];
+      index->key = e->key;
+      index->minutes = e->minutes;
+      index->thresholds = &t[i];
+      index->count = 0;
+      index->primed = false;
+      if (e->key == KEY_MOVE) {
+        book->closes = ring;
+        book->ring = e->minutes + 1;
+      }
+    }
+    t[i] = e->threshold;
+    index->count++;
+    if (i + 1 == entry_count || strcmp(entries[i + 1].symbol, e->symbol) != 0) {
+      ring += book->ring;
+    }
+  }
+  free(entries);
+
+  free(rules);
+  free(books);
+  free(indexes);
+  free(thresholds);
+  free(closes);
+  rules = r;
+  books = b;
+  book_count = b_count;
+  indexes = x;
+  thresholds = t;
+  closes = c;
+  version++;
+
+  stats.rules = count;
+  __debug__("Indexed %d alert rules for %d symbols\n", count, b_count);
+  return 0;
+}
+
+static alert_book_t *book_of(int slot, const char *const symbol) {
+  if (slot_versions[slot] != version) {
+    slot_versions[slot] = version;
+    slot_books[slot] = bsearch(symbol, books, book_count, sizeof(alert_book_t), compare_books);
+  }
+  return slot_books[slot];
+}
+
+// moves the minute ring up to the minute of `time'; minutes without quotes
+// closed at the price before them
+static void book_minute(alert_book_t *book, double time, double price) {
+  long minute = (long)time / 60;
+  if (book->first_minute == 0) {
+    book->first_minute = book->minute = minute;
+  }
+  if (minute > book->minute) {
+    long gap = minute - book->minute;
+    for (long m = book->minute + (gap > book->ring ? gap - book->ring : 0); m < minute; m++) {
+      book->closes[m % book->ring] = book->price;
+    }
+    book->minute = minute;
+  }
+  book->price = price;
+  book->closes[book->minute % book->ring] = price;
+}
+
+static void fire(int slot, const alert_book_t *book, const alert_threshold_t *t, double time) {
+  const alert_rule_t *r = &rules[t->rule];
+  stats.fired++;
+  if (time + r->hold > until[slot]) {
+    until[slot] = time + r->hold;
+  }
+  if (r->kind == ALERT_MOVE) {
+    __info__("Alert on %s: move %g in %d minutes\n", book->symbol, t->value, r->minutes);
+  } else {
+    __info__("Alert on %s: %s %g\n", book->symbol, kind_names[r->kind], r->threshold);
+  }
+}
+
+// fires the thresholds passed on the way from the previous value to this
+// one, returns the number compared
+static unsigned long check_index(int slot, const alert_book_t *book, alert_index_t *index, double value,
+                                 double time, bool *fired) {
+  if (!index->primed) {
+    index->primed = true;
+    index->last = value;
+    return 0;
+  }
+  double from = index->last;
+  index->last = value;
+  if (value == from) {
+    return 0;
+  }
+
+  // rising crosses (from, value], falling [value, from)
+  bool rising = value > from;
+  double low = rising ? from : value;
+  double high = rising ? value : from;
+
+  // the first threshold not below `low'
+  int lo = 0, hi = index->count;
+  while (lo < hi) {
+    int mid = lo + (hi - lo) / 2;
+    if (index->thresholds[mid].value < low) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+
+  unsigned long examined = 0;
+  for (int i = lo; i < index->count && index->thresholds[i].value <= high; i++) {
+    const alert_threshold_t *t = &index->thresholds[i];
+    examined++;
+    if (rising ? t->value > from && (t->cross & CROSS_UP) : t->value < from && (t->cross & CROSS_DOWN)) {
+      fire(slot, book, t, time);
+      *fired = true;
+    }
+  }
+  return examined;
+}
+
+static double monotonic_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+bool alerts_tick(int slot, const char *const symbol, double time, double price, double percent) {
+  if (book_count == 0 || slot < 0 || slot >= SYMBOLS_MAX) {
+    return false;
+  }
+  double start = monotonic_ns();
+  alert_book_t *book = book_of(slot, symbol);
+  if (!book) {
+    return false;
+  }
+
+  if (book->closes) {
+    book_minute(book, time, price);
+  }
+
+  bool fired = false;
+  unsigned long examined = 0;
+  for (int i = 0; i < book->index_count; i++) {
+    alert_index_t *index = &book->indexes[i];
+    double value = price;
+    if (index->key == KEY_PERCENT) {
+      value = percent;
+    } else if (index->key == KEY_MOVE) {
+      long from = book->minute - index->minutes;
+      if (from < book->first_minute) {
+        continue;
+      }
+      value = price - book->closes[from % book->ring];
+    }
+    examined += check_index(slot, book, index, value, time, &fired);
+  }
+
+  double ns = monotonic_ns() - start;
+  stats.ticks++;
+  stats.examined += examined;
+  if (examined > stats.examined_max) {
+    stats.examined_max = examined;
+  }
+  ns_total += ns;
+  if (ns > stats.ns_max) {
+    stats.ns_max = ns;
+  }
+  return fired;
+}
+
+bool alerts_active(int slot, double time) {
+  return slot >= 0 && slot < SYMBOLS_MAX && time < until[slot];
+}
+
+const char *alerts_kind_name(alert_kind_t kind) {
+  return kind_names[kind];
+}
+
+void alerts_stats(alerts_stats_t *out) {
+  *out = stats;
+  out->ns_avg = stats.ticks ? ns_total / stats.ticks : 0;
+}
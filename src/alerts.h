@@ -0,0 +1,110 @@
+#ifndef INCLUDE_ALERTS_H
+#define INCLUDE_ALERTS_H
+
+#include <stdbool.h>
+#include "symbols.h"
+
+/**
+ * Longest window of a move alert, in minutes.
+ */
+#define ALERT_MOVE_MINUTES 60
+
+/**
+ * What an alert watches.
+ */
+typedef enum {
+  // the price rises to or above the threshold
+  ALERT_ABOVE,
+  // the price falls to or below the threshold
+  ALERT_BELOW,
+  // the price reaches the threshold from either side
+  ALERT_CROSSES,
+  // the percent change rises to or above the threshold
+  ALERT_CHANGE_ABOVE,
+  // the percent change falls to or below the threshold
+  ALERT_CHANGE_BELOW,
+  // the price moved more than the threshold, either way, within `minutes'
+  ALERT_MOVE,
+} alert_kind_t;
+
+/**
+ * Struct representing one alert rule.
+ */
+typedef struct alert_rule_t {
+  char symbol[SYMBOL_NAME_LEN];
+  alert_kind_t kind;
+  double threshold;
+  // window of ALERT_MOVE, up to ALERT_MOVE_MINUTES
+  int minutes;
+  // seconds of quote time the symbol stays highlighted after the alert
+  double hold;
+} alert_rule_t;
+
+/**
+ * Counters of the rule evaluation, for the `stats' control command.
+ */
+typedef struct alerts_stats_t {
+  int rules;
+  // quotes of symbols that have rules
+  unsigned long ticks;
+  // thresholds compared, in total and at most for one quote
+  unsigned long examined;
+  unsigned long examined_max;
+  unsigned long fired;
+  // time spent per quote
+  double ns_avg;
+  double ns_max;
+} alerts_stats_t;
+
+/**
+ * Replaces the alert rules.
+ *
+ * The rules are indexed per symbol, in arrays sorted by threshold for each
+ * value they watch: the price, the percent change and the move over each
+ * distinct window. A quote then only looks at the thresholds between the
+ * previous and the new value, found by binary search, instead of at every
+ * rule. The first quote of a symbol after the swap only sets where its
+ * values start from.
+ *
+ * @param rules The rules, copied.
+ * @param count The number of rules.
+ *
+ * @returns 0 on success, -1 if the index cannot be allocated, in which
+ *          case the previous rules stay.
+ */
+int alerts_set(const alert_rule_t *const rules, int count);
+
+/**
+ * Evaluates the rules of a symbol against a quote.
+ *
+ * @param slot    The symbol slot, see symbol_slot().
+ * @param symbol  The symbol name.
+ * @param time    The quote time in seconds since the epoch.
+ * @param price   The last price.
+ * @param percent The percent change.
+ *
+ * @returns true if an alert fired.
+ */
+bool alerts_tick(int slot, const char *const symbol, double time, double price, double percent);
+
+/**
+ * @param slot The symbol slot.
+ * @param time The time of the quote to show, in seconds since the epoch.
+ *
+ * @returns Whether the symbol is highlighted by an alert at `time'.
+ */
+bool alerts_active(int slot, double time);
+
+/**
+ * @returns The name of an alert kind, which is also its config key:
+ *          "above", "below", "crosses", "change-above", "change-below" or
+ *          "move".
+ */
+const char *alerts_kind_name(alert_kind_t kind);
+
+/**
+ * @param out Receives the counters.
+ */
+void alerts_stats(alerts_stats_t *out);
+
+#endif
@@ -0,0 +1,121 @@
+#include "analytics.h"
+#include "symbols.h"
+
+typedef struct {
+  // VWAP sums since `session' started
+  double session;
+  double value;
+  double volume;
+
+  // the current minute and the close before it, its move is the return
+  long minute;
+  double reference;
+  double close;
+  bool traded;
+
+  // ring of completed one minute returns, with their running mean and sum
+  // of squared deviations
+  double returns[ANALYTICS_WINDOW];
+  int head;
+  int count;
+  double mean;
+  double m2;
+} analytics_series_t;
+
+// Static like the bars, untouched pages of symbols that never trade cost no
+// memory
+static analytics_series_t series[SYMBOLS_MAX];
+
+// Newton's method, so that we don't need sqrt() and hence -lm linking
+static double square_root(double x) {
+  if (x <= 0) {
+    return 0;
+  }
+  double r = x > 1 ? x : 1;
+  for (int i = 0; i < 64; i++) {
+    double next = 0.5 * (r + x / r);
+    if (next >= r) {
+      break;
+    }
+    r = next;
+  }
+  return r;
+}
+
+static double percent_return(double from, double to) {
+  return from != 0 ? 100.0 * (to - from) / from : 0.0;
+}
+
+// adds the return of a completed minute, dropping the oldest one once the
+// window is full
+static void push_return(analytics_series_t *s, double x) {
+  if (s->count == ANALYTICS_WINDOW) {
+    double old = s->returns[s->head];
+    s->count--;
+    if (s->count == 0) {
+      s->mean = s->m2 = 0;
+    } else {
+      double delta = old - s->mean;
+      s->mean -= delta / s->count;
+      s->m2 -= delta * (old - s->mean);
+    }
+  }
+  s->returns[s->head] = x;
+  s->head = (s->head + 1) % ANALYTICS_WINDOW;
+  s->count++;
+  double delta = x - s->mean;
+  s->mean += delta / s->count;
+  s->m2 += delta * (x - s->mean);
+  // rounding must not make it negative
+  if (s->m2 < 0) {
+    s->m2 = 0;
+  }
+}
+
+void analytics_tick(int slot, double time, double session, double price, long volume) {
+  if (slot < 0 || slot >= SYMBOLS_MAX) {
+    return;
+  }
+  analytics_series_t *s = &series[slot];
+
+  if (!s->traded || session != s->session) {
+    s->session = session;
+    s->value = s->volume = 0;
+  }
+  s->value += price * volume;
+  s->volume += volume;
+
+  long minute = (long)time / 60;
+  if (!s->traded) {
+    s->minute = minute;
+    s->reference = price;
+  } else if (minute > s->minute) {
+    push_return(s, percent_return(s->reference, s->close));
+    // minutes without trades did not move, only the last window of them
+    // can still be in the ring
+    long flat = minute - s->minute - 1;
+    for (long i = 0; i < flat && i < ANALYTICS_WINDOW; i++) {
+      push_return(s, 0);
+    }
+    s->minute = minute;
+    s->reference = s->close;
+  }
+  s->close = price;
+  s->traded = true;
+}
+
+bool analytics_get(int slot, analytics_t *out) {
+  if (slot < 0 || slot >= SYMBOLS_MAX || !series[slot].traded) {
+    return false;
+  }
+  const analytics_series_t *s = &series[slot];
+
+  out->vwap = s->volume > 0 ? s->value / s->volume : 0;
+  out->minutes = s->count;
+  out->volatility = s->count > 1 ? square_root(s->m2 / (s->count - 1)) : 0;
+  out->zscore = 0;
+  if (out->volatility > 0) {
+    out->zscore = (percent_return(s->reference, s->close) - s->mean) / out->volatility;
+  }
+  return true;
+}
@@ -0,0 +1,50 @@
+#ifndef INCLUDE_ANALYTICS_H
+#define INCLUDE_ANALYTICS_H
+
+#include <stdbool.h>
+
+/**
+ * Number of one minute returns the volatility and z-score are taken over.
+ */
+#define ANALYTICS_WINDOW 30
+
+/**
+ * Struct with the statistics of a symbol.
+ */
+typedef struct analytics_t {
+  // volume weighted average price of the session, 0 before any volume
+  double vwap;
+  // standard deviation of the one minute returns in the window, in percent
+  double volatility;
+  // the move of the current minute in standard deviations of the window
+  double zscore;
+  // completed minutes in the window, volatility and z-score need two
+  int minutes;
+} analytics_t;
+
+/**
+ * Adds a trade tick to the statistics of a symbol.
+ *
+ * Everything is O(1) per tick: the VWAP sums restart with the session, and
+ * mean and variance of the returns in the window are kept with Welford's
+ * updates as returns enter and leave its ring. A minute without trades
+ * counts as a return of 0, so a gap cannot pass for a single minute's move.
+ * All storage is static.
+ *
+ * @param slot    The symbol slot, see symbol_slot().
+ * @param time    The trade time in seconds since the epoch.
+ * @param session Start of the session the trade belongs to.
+ * @param price   The trade price.
+ * @param volume  The traded size.
+ */
+void analytics_tick(int slot, double time, double session, double price, long volume);
+
+/**
+ * @param slot The symbol slot.
+ * @param out  Receives the statistics.
+ *
+ * @returns false if the symbol has not traded yet.
+ */
+bool analytics_get(int slot, analytics_t *out);
+
+#endif
@@ -0,0 +1,165 @@
+#include "animation.h"
+#include "symbols.h"
+#include "options.h"
+#include "log.h"
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#ifdef __linux__
+  #include <sys/timerfd.h>
+#endif
+
+typedef struct {
+    // clock time the flash started, 0 if none runs
+    double start;
+    bool up;
+} flash_t;
+
+static flash_t flashes[SYMBOLS_MAX];
+// slots with a flash, so that checking whether anything animates does not
+// walk all symbols
+static int active[SYMBOLS_MAX];
+static int active_count = 0;
+
+// clock time the next frame is due, and the average cost of the frames
+static double next_frame = 0;
+static double frame_cost = 0;
+// the deadline the timer is armed for, -1 while disarmed
+static double armed_for = -2;
+
+double animation_clock(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+void animation_flash(int slot, bool up)
+{
+    if (options.flash_seconds <= 0 || slot < 0 || slot >= SYMBOLS_MAX) {
+        return;
+    }
+    if (flashes[slot].start == 0) {
+        active[active_count++] = slot;
+    }
+    flashes[slot].start = animation_clock();
+    flashes[slot].up = up;
+}
+
+rgba_color animation_color(int slot, rgba_color color)
+{
+    if (slot < 0 || slot >= SYMBOLS_MAX || flashes[slot].start == 0) {
+        return color;
+    }
+    if (options.flash_seconds <= 0) {
+        return color;
+    }
+    double t = (animation_clock() - flashes[slot].start) / options.flash_seconds;
+    if (t >= 1) {
+        return color;
+    }
+
+    // eases out: fast away from the flash, slow into the quote color
+    float w = (1 - t) * (1 - t);
+    rgba_color flash = flashes[slot].up ? rgba_color_new(0.30f, 0.95f, 0.40f, 0.9f)
+                                        : rgba_color_new(1.00f, 0.30f, 0.25f, 0.9f);
+    return rgba_color_new(w * flash.r + (1 - w) * color.r, w * flash.g + (1 - w) * color.g,
+                          w * flash.b + (1 - w) * color.b, w * flash.a + (1 - w) * color.a);
+}
+
+// a fade that ended stays active until the next frame, which then draws
+// the quote color
+bool animation_active(int slot)
+{
+    return slot >= 0 && slot < SYMBOLS_MAX && flashes[slot].start != 0;
+}
+
+bool animation_running(void)
+{
+    return active_count > 0;
+}
+
+double animation_wait(void)
+{
+    if (!animation_running()) {
+        return -1;
+    }
+    double wait = next_frame - animation_clock();
+    return wait > 0 ? wait : 0;
+}
+
+void animation_frame_done(double cost)
+{
+    double now = animation_clock();
+    for (int i = 0; i < active_count;) {
+        flash_t *f = &flashes[active[i]];
+        if (now - f->start < options.flash_seconds) {
+            i++;
+            continue;
+        }
+        f->start = 0;
+        active[i] = active[--active_count];
+    }
+
+    frame_cost = frame_cost > 0 ? 0.8 * frame_cost + 0.2 * cost : cost;
+
+    double interval = 1.0 / (options.animation_fps > 0 ? options.animation_fps : 1);
+    if (options.animation_budget > 0 && frame_cost * 100 / options.animation_budget > interval) {
+        interval = frame_cost * 100 / options.animation_budget;
+        __debug__("Animation frames take %.2f ms, slowing down to %.1f fps\n", frame_cost * 1e3, 1 / interval);
+    }
+    next_frame = now + interval;
+}
+
+#ifdef __linux__
+int animation_timer(void)
+{
+    int fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (fd < 0) {
+        __perror__("Cannot create animation timer");
+    }
+    return fd;
+}
+
+void animation_timer_arm(int fd)
+{
+    double wait = animation_wait();
+    double due = wait < 0 ? -1 : next_frame;
+    // only touched when the deadline moved
+    if (fd < 0 || due == armed_for) {
+        return;
+    }
+    armed_for = due;
+
+    struct itimerspec spec = {0};
+    if (wait >= 0) {
+        // a zero expiration would disarm it
+        long ns = wait * 1e9;
+        spec.it_value.tv_sec = ns / 1000000000;
+        spec.it_value.tv_nsec = ns % 1000000000 + (ns == 0);
+    }
+    timerfd_settime(fd, 0, &spec, NULL);
+}
+
+bool animation_timer_read(int fd)
+{
+    uint64_t expired = 0;
+    return read(fd, &expired, sizeof(expired)) == sizeof(expired) && expired > 0;
+}
+#else
+int animation_timer(void)
+{
+    return -1;
+}
+
+void animation_timer_arm(int fd)
+{
+    (void)fd;
+}
+
+bool animation_timer_read(int fd)
+{
+    (void)fd;
+    return false;
+}
+#endif
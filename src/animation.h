@@ -0,0 +1,86 @@
+#ifndef INCLUDE_ANIMATION_H
+#define INCLUDE_ANIMATION_H
+
+#include <stdbool.h>
+#include "color.h"
+
+/**
+ * Starts the flash of a symbol after a tick: its color jumps to a bright
+ * green or red and fades into the color of the quote over
+ * `options.flash_seconds'. A flash still running starts over.
+ *
+ * @param slot The symbol slot, see symbol_slot().
+ * @param up   Whether the price rose, otherwise it fell.
+ */
+void animation_flash(int slot, bool up);
+
+/**
+ * @param slot  The symbol slot.
+ * @param color The color the symbol is shown in without animation.
+ *
+ * @returns The color of the symbol at this moment of its fade, or `color'
+ *          if it is not animating.
+ */
+rgba_color animation_color(int slot, rgba_color color);
+
+/**
+ * @returns Whether the symbol is animating. A fade that ended counts until
+ *          the next frame, which draws the quote color.
+ */
+bool animation_active(int slot);
+
+/**
+ * @returns Whether any symbol is animating. When none is, nothing needs a
+ *          frame and the backends can sleep.
+ */
+bool animation_running(void);
+
+/**
+ * @returns Seconds until the next animation frame is due, 0 if it is due
+ *          now, or -1 if nothing animates.
+ */
+double animation_wait(void);
+
+/**
+ * Accounts for a drawn frame and forgets the fades that ended before it.
+ * Data updates count as well, so frames of both kinds are paced together.
+ *
+ * The next frame is due after `1 / options.animation_fps', or later if
+ * the frames took more than `options.animation_budget' percent of the time
+ * in between, which keeps slow drawing from eating the CPU.
+ *
+ * @param cost Seconds spent drawing the frame.
+ */
+void animation_frame_done(double cost);
+
+/**
+ * Creates a timer that becomes readable when the next frame is due.
+ *
+ * @returns A descriptor for animation_timer_arm() and
+ *          animation_timer_read(), or -1 where timers cannot be waited
+ *          for like files; animation_wait() then tells how long to sleep.
+ */
+int animation_timer(void);
+
+/**
+ * Arms the timer for the next frame, or disarms it if nothing animates.
+ *
+ * @param fd The descriptor returned by animation_timer().
+ */
+void animation_timer_arm(int fd);
+
+/**
+ * Drains the timer.
+ *
+ * @param fd The descriptor returned by animation_timer().
+ *
+ * @returns true if it expired.
+ */
+bool animation_timer_read(int fd);
+
+/**
+ * @returns Seconds since an arbitrary fixed point, for frame costs.
+ */
+double animation_clock(void);
+
+#endif
@@ -0,0 +1,136 @@
+#include "bars.h"
+#include "symbols.h"
+#include "options.h"
+#include "log.h"
+
+#include <string.h>
+#include <time.h>
+
+typedef struct {
+  bar_t current;
+  double next_roll;             // start of the bar after `current'
+  bar_t history[BARS_HISTORY];  // ring of completed bars
+  int head;                     // newest completed bar
+  int count;
+} bar_series_t;
+
+// Static, so nothing is allocated on the tick path. The table lives in BSS:
+// pages of symbols that never trade are never touched and cost no memory.
+static bar_series_t series[SYMBOLS_MAX][BAR_PERIODS];
+
+static const char *const period_names[BAR_PERIODS] = {
+  [BAR_1MIN] = "1m",
+  [BAR_5MIN] = "5m",
+  [BAR_SESSION] = "session",
+};
+
+int bars_parse_period(const char *const name) {
+  for (int i = 0; i < BAR_PERIODS; i++) {
+    if (strcmp(name, period_names[i]) == 0) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+// start of the session containing `time', sessions begin at
+// options.session_start minutes after local midnight
+static double session_start(double time) {
+  time_t t = time;
+  struct tm tm;
+  localtime_r(&t, &tm);
+  tm.tm_hour = options.session_start / 60;
+  tm.tm_min = options.session_start % 60;
+  tm.tm_sec = 0;
+  tm.tm_isdst = -1;
+  time_t start = mktime(&tm);
+  if (start > t) {
+    tm.tm_mday--;
+    tm.tm_isdst = -1;
+    start = mktime(&tm);
+  }
+  return start;
+}
+
+// start and end of the bar of `period' containing `time'
+static double bar_start(bar_period_t period, double time, double *end) {
+  switch (period) {
+    case BAR_1MIN:
+    case BAR_5MIN: {
+      long len = (period == BAR_1MIN) ? 60 : 300;
+      long start = (long)time / len * len;
+      *end = start + len;
+      return start;
+    }
+    default: {
+      double start = session_start(time);
+      // mktime normalises the day overflow, DST days included
+      time_t t = start;
+      struct tm tm;
+      localtime_r(&t, &tm);
+      tm.tm_mday++;
+      tm.tm_isdst = -1;
+      *end = mktime(&tm);
+      return start;
+    }
+  }
+}
+
+static void series_tick(bar_series_t *s, bar_period_t period, double time, double price, long volume) {
+  bar_t *bar = &s->current;
+
+  if (bar->ticks > 0 && time >= s->next_roll) {
+    s->head = (s->head + 1) % BARS_HISTORY;
+    s->history[s->head] = *bar;
+    if (s->count < BARS_HISTORY) s->count++;
+    bar->ticks = 0;
+  }
+
+  if (bar->ticks == 0) {
+    bar->time = bar_start(period, time, &s->next_roll);
+    bar->open = bar->high = bar->low = price;
+    bar->volume = 0;
+  } else if (price > bar->high) {
+    bar->high = price;
+  } else if (price < bar->low) {
+    bar->low = price;
+  }
+  bar->close = price;
+  bar->volume += volume;
+  bar->ticks++;
+}
+
+void bars_tick(int slot, double time, double price, long volume) {
+  if (slot < 0 || slot >= SYMBOLS_MAX) {
+    return;
+  }
+  for (int period = 0; period < BAR_PERIODS; period++) {
+    series_tick(&series[slot][period], period, time, price, volume);
+  }
+}
+
+const bar_t *bars_get(int slot, bar_period_t period, int ago) {
+  if (slot < 0 || slot >= SYMBOLS_MAX || period >= BAR_PERIODS) {
+    return NULL;
+  }
+  bar_series_t *s = &series[slot][period];
+  if (ago == 0) {
+    return (s->current.ticks > 0) ? &s->current : NULL;
+  }
+  if (ago < 0 || ago > s->count) {
+    return NULL;
+  }
+  return &s->history[(s->head - (ago - 1) + BARS_HISTORY) % BARS_HISTORY];
+}
+
+double bar_change(const bar_t *const bar) {
+  return bar->close - bar->open;
+}
+
+double bar_percent_change(const bar_t *const bar) {
+  return (bar->open != 0) ? 100.0 * (bar->close - bar->open) / bar->open : 0.0;
+}
+
+double bar_range(const bar_t *const bar) {
+  return bar->high - bar->low;
+}
@@ -0,0 +1,78 @@
+#ifndef INCLUDE_BARS_H
+#define INCLUDE_BARS_H
+
+/**
+ * Bar periods aggregated for every symbol.
+ */
+typedef enum {
+  BAR_1MIN,
+  BAR_5MIN,
+  BAR_SESSION,
+  BAR_PERIODS
+} bar_period_t;
+
+/**
+ * Number of completed bars kept per symbol and period.
+ */
+#define BARS_HISTORY 32
+
+/**
+ * Struct representing one OHLC bar.
+ *
+ * `time' is the start of the bar, in seconds since the epoch.
+ */
+typedef struct bar_t {
+  double time;
+  double open, high, low, close;
+  long volume;
+  long ticks;
+} bar_t;
+
+/**
+ * Adds a trade tick to the current bars of a symbol.
+ *
+ * Updates the current bar of every period in O(1). When the tick falls past
+ * the end of a bar, that bar is rolled into the period's history ring first.
+ * All storage is static, nothing is allocated.
+ *
+ * @param slot   The symbol slot, see symbol_slot().
+ * @param time   The trade time in seconds since the epoch.
+ * @param price  The trade price.
+ * @param volume The traded size.
+ */
+void bars_tick(int slot, double time, double price, long volume);
+
+/**
+ * Returns a bar of a symbol.
+ *
+ * @param slot   The symbol slot.
+ * @param period The bar period.
+ * @param ago    0 for the current bar, n for the n-th completed bar before.
+ *
+ * @returns The bar, or NULL if there is no such bar (yet).
+ */
+const bar_t *bars_get(int slot, bar_period_t period, int ago);
+
+/**
+ * Parses a bar period name ("1m", "5m" or "session").
+ *
+ * @returns The period, or -1 if the name is unknown.
+ */
+int bars_parse_period(const char *const name);
+
+/**
+ * @returns The move from the open to the close of the bar.
+ */
+double bar_change(const bar_t *const bar);
+
+/**
+ * @returns The move from the open to the close of the bar, in percent.
+ */
+double bar_percent_change(const bar_t *const bar);
+
+/**
+ * @returns The difference between the high and the low of the bar.
+ */
+double bar_range(const bar_t *const bar);
+
+#endif
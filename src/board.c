@@ -0,0 +1,296 @@
+#ifdef CAIRO
+
+#define _GNU_SOURCE     // for pthread_timedjoin_np
+#include <errno.h>
+#include <fcntl.h>
+#include <fnmatch.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "board.h"
+#include "control.h"
+#include "log.h"
+#include "options.h"
+#include "symbols.h"
+
+#ifdef __linux__
+
+#include <linux/futex.h>
+#include <sys/eventfd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+
+#define BOARD_MAGIC 0x51756f74
+// bumped whenever the layout changes, publisher and readers must agree
+#define BOARD_VERSION 2
+
+typedef struct {
+  // odd while the publisher rewrites the quote
+  _Atomic uint32_t seq;
+  stock_data_t quote;
+} board_slot_t;
+
+typedef struct {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t size;
+  // slots [0, count) are in use, indexed by the publisher's symbol slots
+  _Atomic uint32_t count;
+  // bumped after every quote, readers sleep on it
+  _Atomic uint32_t generation;
+  board_slot_t slots[SYMBOLS_MAX];
+} board_t;
+
+static board_t *board = NULL;
+static int board_fd = -1;
+
+// reader side: the waiter thread signals `wake_fd' when the board changed,
+// until `stopping' is set
+static int wake_fd = -1;
+static pthread_t waiter;
+static atomic_bool stopping = false;
+static uint32_t seen[SYMBOLS_MAX];
+
+static long futex(_Atomic uint32_t *addr, int op, uint32_t val) {
+  // not FUTEX_PRIVATE_FLAG, waiters live in other processes
+  return syscall(SYS_futex, addr, op, val, NULL, NULL, 0);
+}
+
+int board_publish_start(void) {
+  board_fd = shm_open(BOARD_NAME, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+  if (board_fd < 0) {
+    __perror__("Cannot create quote board");
+    return -1;
+  }
+
+  if (flock(board_fd, LOCK_EX | LOCK_NB) < 0) {
+    __error__("Another instance already publishes the quote board\n");
+    close(board_fd);
+    board_fd = -1;
+    return -1;
+  }
+
+  // the sessions of other users attach to it too, whatever our umask
+  fchmod(board_fd, 0644);
+  if (ftruncate(board_fd, sizeof(board_t)) < 0) {
+    __perror__("Cannot size quote board");
+    board_stop();
+    return -1;
+  }
+
+  board = mmap(NULL, sizeof(board_t), PROT_READ | PROT_WRITE, MAP_SHARED, board_fd, 0);
+  if (board == MAP_FAILED) {
+    board = NULL;
+    __perror__("Cannot map quote board");
+    board_stop();
+    return -1;
+  }
+
+  // a previous publisher may have left the board behind; sequence numbers
+  // carry on from there, so attached readers see every slot change, and a
+  // slot it died writing is marked complete
+  atomic_store_explicit(&board->count, 0, memory_order_relaxed);
+  for (int i = 0; i < SYMBOLS_MAX; i++) {
+    uint32_t seq = atomic_load_explicit(&board->slots[i].seq, memory_order_relaxed);
+    atomic_store_explicit(&board->slots[i].seq, (seq + 1) & ~1u, memory_order_relaxed);
+  }
+  board->version = BOARD_VERSION;
+  board->size = sizeof(board_t);
+  atomic_thread_fence(memory_order_release);
+  board->magic = BOARD_MAGIC;
+
+  __info__("Publishing quote board %s\n", BOARD_NAME);
+  return 0;
+}
+
+void board_publish(const stock_data_t *const quote) {
+  if (!board) {
+    return;
+  }
+
+  int slot = symbol_slot(quote->symbol);
+  if (slot < 0) {
+    return;
+  }
+
+  board_slot_t *s = &board->slots[slot];
+  uint32_t seq = atomic_load_explicit(&s->seq, memory_order_relaxed);
+  atomic_store_explicit(&s->seq, seq + 1, memory_order_relaxed);
+  atomic_thread_fence(memory_order_release);
+  s->quote = *quote;
+  atomic_store_explicit(&s->seq, seq + 2, memory_order_release);
+
+  if ((uint32_t)slot >= atomic_load_explicit(&board->count, memory_order_relaxed)) {
+    atomic_store_explicit(&board->count, slot + 1, memory_order_release);
+  }
+
+  atomic_fetch_add_explicit(&board->generation, 1, memory_order_release);
+  futex(&board->generation, FUTEX_WAKE, INT_MAX);
+}
+
+static void *board_wait(void *arg) {
+  (void)arg;
+  uint32_t generation = atomic_load_explicit(&board->generation, memory_order_acquire);
+  while (!atomic_load(&stopping)) {
+    // returns at once if the generation moved since it was read
+    futex(&board->generation, FUTEX_WAIT, generation);
+    uint32_t now = atomic_load_explicit(&board->generation, memory_order_acquire);
+    if (now != generation) {
+      generation = now;
+      uint64_t one = 1;
+      if (write(wake_fd, &one, sizeof(one)) < 0 && errno != EAGAIN) {
+        __perror__("Cannot signal quote board change");
+      }
+    }
+  }
+  return NULL;
+}
+
+int board_attach(void) {
+  board_fd = shm_open(BOARD_NAME, O_RDONLY | O_CLOEXEC, 0);
+  struct stat st;
+  if (board_fd < 0 || fstat(board_fd, &st) < 0 || st.st_size < (off_t)sizeof(board_t)) {
+    __error__("No quote board found, start an instance with --quote-board publish first\n");
+    board_stop();
+    return -1;
+  }
+
+  board = mmap(NULL, sizeof(board_t), PROT_READ, MAP_SHARED, board_fd, 0);
+  if (board == MAP_FAILED) {
+    board = NULL;
+    __perror__("Cannot map quote board");
+    board_stop();
+    return -1;
+  }
+
+  if (board->magic != BOARD_MAGIC || board->version != BOARD_VERSION || board->size != sizeof(board_t)) {
+    __error__("The quote board was published by an incompatible version\n");
+    board_stop();
+    return -1;
+  }
+  atomic_thread_fence(memory_order_acquire);
+
+  // starts out readable to pick up what is already on the board
+  atomic_store(&stopping, false);
+  wake_fd = eventfd(1, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (wake_fd >= 0 && pthread_create(&waiter, NULL, board_wait, NULL) != 0) {
+    close(wake_fd);
+    wake_fd = -1;
+  }
+  if (wake_fd < 0) {
+    __perror__("Cannot wait for quote board changes");
+    board_stop();
+    return -1;
+  }
+
+  __info__("Attached to quote board %s\n", BOARD_NAME);
+  return wake_fd;
+}
+
+static bool subscribed(const char *const symbol) {
+  for (int i = 0; i < options.channel_count; i++) {
+    // patterns match like Redis' PSUBSCRIBE
+    if (fnmatch(options.channels[i], symbol, 0) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void board_poll(void) {
+  uint64_t pending;
+  if (read(wake_fd, &pending, sizeof(pending)) < 0) {
+    return;
+  }
+
+  uint32_t count = atomic_load_explicit(&board->count, memory_order_acquire);
+  for (uint32_t i = 0; i < count && i < SYMBOLS_MAX; i++) {
+    board_slot_t *s = &board->slots[i];
+    uint32_t seq = atomic_load_explicit(&s->seq, memory_order_acquire);
+    // a slot being written is picked up with the wake-up that follows
+    if (seq == seen[i] || (seq & 1)) {
+      continue;
+    }
+
+    stock_data_t quote = s->quote;
+    atomic_thread_fence(memory_order_acquire);
+    if (atomic_load_explicit(&s->seq, memory_order_relaxed) != seq) {
+      continue;
+    }
+    seen[i] = seq;
+
+    quote.symbol[sizeof(quote.symbol) - 1] = '\0';
+    quote.fmttime[sizeof(quote.fmttime) - 1] = '\0';
+    if (subscribed(quote.symbol)) {
+      control_stats.messages++;
+      stock_quote(&quote);
+    }
+  }
+}
+
+void board_stop(void) {
+  if (wake_fd >= 0) {
+    // the waiter only checks `stopping' between futex waits; a wake-up that
+    // comes before it sleeps again is lost, so it is repeated until the
+    // thread is gone. Readers of other processes just wait again
+    atomic_store(&stopping, true);
+    int joined;
+    do {
+      futex(&board->generation, FUTEX_WAKE, INT_MAX);
+      struct timespec until;
+      clock_gettime(CLOCK_REALTIME, &until);
+      until.tv_nsec += 10000000;
+      if (until.tv_nsec >= 1000000000) {
+        until.tv_sec++;
+        until.tv_nsec -= 1000000000;
+      }
+      joined = pthread_timedjoin_np(waiter, NULL, &until);
+    } while (joined == ETIMEDOUT);
+    close(wake_fd);
+    wake_fd = -1;
+  }
+  if (board) {
+    munmap(board, sizeof(board_t));
+    board = NULL;
+  }
+  if (board_fd >= 0) {
+    // the object stays, a restarted publisher takes it over
+    close(board_fd);
+    board_fd = -1;
+  }
+}
+
+#else
+
+int board_publish_start(void) {
+  __error__("The quote board is only available on Linux\n");
+  return -1;
+}
+
+void board_publish(const stock_data_t *const quote) {
+  (void)quote;
+}
+
+int board_attach(void) {
+  __error__("The quote board is only available on Linux\n");
+  return -1;
+}
+
+void board_poll(void) {
+}
+
+void board_stop(void) {
+}
+
+#endif
+
+#endif
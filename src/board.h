@@ -0,0 +1,53 @@
+#ifndef INCLUDE_BOARD_H
+#define INCLUDE_BOARD_H
+
+#include "stock.h"
+
+/**
+ * Name of the POSIX shared memory object holding the quote board.
+ */
+#define BOARD_NAME "/activate-linux-quotes"
+
+/**
+ * Creates the quote board and makes this instance its only publisher.
+ *
+ * The board is a table of the latest decoded quote per symbol. Every slot
+ * is guarded by its own sequence lock, so readers copy quotes without ever
+ * blocking the publisher, which only adds a futex wake per quote.
+ *
+ * @returns 0 on success, -1 if the board cannot be created or another
+ *          instance already publishes it.
+ */
+int board_publish_start(void);
+
+/**
+ * Publishes a decoded quote to the board.
+ *
+ * @param quote The quote, as filled by parse_stock_data().
+ */
+void board_publish(const stock_data_t *const quote);
+
+/**
+ * Maps the quote board read-only instead of connecting to Redis.
+ *
+ * A helper thread sleeps on the board's futex and turns changes into
+ * readability of the returned descriptor, which fits the backends' event
+ * loops.
+ *
+ * @returns A descriptor to wait on before calling board_poll(), or -1 if
+ *          no compatible board is published.
+ */
+int board_attach(void);
+
+/**
+ * Hands the quotes changed since the last call to stock_quote(), for the
+ * symbols in `options.channels'.
+ */
+void board_poll(void);
+
+/**
+ * Detaches from or stops publishing the board.
+ */
+void board_stop(void);
+
+#endif
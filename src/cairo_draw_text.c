@@ -2,95 +2,283 @@
 
 #include "cairo_draw_text.h"
 #include "options.h"
+#include "sparkline.h"
+#include "ticker.h"
+#include "rotation.h"
 #include <cairo/cairo.h>
 #include <stdlib.h>
+#include <string.h>
 
-void draw_text(cairo_t *const cr, int xshape_mask)
+struct text_renderer_t
 {
-    // clear surface
-    cairo_operator_t prev_operator = cairo_get_operator(cr);
-    cairo_set_operator(cr, CAIRO_OPERATOR_CLEAR);
-    cairo_paint(cr);
-    if (xshape_mask == 0)
+    // what the fonts were made for
+    char *font;
+    bool bold;
+    bool italic;
+    double scale;
+
+    cairo_font_face_t *face;
+    // indexed by anti-aliasing, then title or subtitle
+    cairo_scaled_font_t *fonts[2][2];
+
+    // the last subtitle as given, and split into lines
+    char *subtitle;
+    char *lines;
+    size_t size;
+    const char *second_line;
+};
+
+// outputs at different scales each keep their renderer, the oldest one
+// is replaced when another is needed
+#define TEXT_RENDERERS 4
+
+static text_renderer_t *renderers[TEXT_RENDERERS];
+static int oldest = 0;
+
+static cairo_scaled_font_t *scaled_font(cairo_font_face_t *face, double size, bool antialias)
+{
+    cairo_matrix_t font_matrix, ctm;
+    cairo_matrix_init_scale(&font_matrix, size, size);
+    cairo_matrix_init_identity(&ctm);
+
+    // no subpixel anti-aliasing because we are on transparent BG
+    cairo_font_options_t *font_options = cairo_font_options_create();
+    cairo_font_options_set_antialias(font_options, antialias ? CAIRO_ANTIALIAS_GRAY : CAIRO_ANTIALIAS_NONE);
+    cairo_scaled_font_t *font = cairo_scaled_font_create(face, &font_matrix, &ctm, font_options);
+    cairo_font_options_destroy(font_options);
+    return font;
+}
+
+text_renderer_t *text_renderer_new(const Options *const options, double scale)
+{
+    text_renderer_t *r = calloc(1, sizeof(text_renderer_t));
+    if (!r)
     {
-        cairo_set_operator(cr, prev_operator);
+        return NULL;
     }
+    r->font = strdup(options->custom_font);
+    r->bold = options->bold_mode;
+    r->italic = options->italic_mode;
+    r->scale = scale;
 
-    // set text color
-    if (xshape_mask == 0)
+    r->face = cairo_toy_font_face_create(options->custom_font,
+                                         r->italic ? CAIRO_FONT_SLANT_ITALIC : CAIRO_FONT_SLANT_NORMAL,
+                                         r->bold ? CAIRO_FONT_WEIGHT_BOLD : CAIRO_FONT_WEIGHT_NORMAL);
+    for (int antialias = 0; antialias < 2; antialias++)
     {
-        cairo_set_source_rgba(cr, options.text_color.r, options.text_color.g, options.text_color.b,
-                              options.text_color.a);
+        r->fonts[antialias][0] = scaled_font(r->face, 24 * scale, antialias);
+        r->fonts[antialias][1] = scaled_font(r->face, 16 * scale, antialias);
     }
-    else
+
+    if (!r->font || cairo_scaled_font_status(r->fonts[1][1]) != CAIRO_STATUS_SUCCESS)
     {
-        cairo_set_operator(cr, CAIRO_OPERATOR_OVER);
+        text_renderer_free(r);
+        return NULL;
     }
-    
-    // cheap hack for xshape
-    if (xshape_mask == 2)
+    return r;
+}
+
+bool text_renderer_matches(const text_renderer_t *const r, const Options *const options, double scale)
+{
+    return r->scale == scale && r->bold == options->bold_mode && r->italic == options->italic_mode &&
+           strcmp(r->font, options->custom_font) == 0;
+}
+
+cairo_scaled_font_t *text_renderer_title_font(text_renderer_t *const r, bool antialias)
+{
+    return r->fonts[antialias][0];
+}
+
+// splits the subtitle at its first newline, as cairo cannot do it out of
+// the box; quotes keep their subtitle until the next one, so this mostly
+// finds the previous split still valid
+static void split_subtitle(text_renderer_t *const r, const char *const subtitle)
+{
+    if (r->subtitle && strcmp(r->subtitle, subtitle) == 0)
     {
-        cairo_set_source_rgb(cr, options.text_color.r, options.text_color.g, options.text_color.b);
-        cairo_paint(cr);
         return;
     }
-    
-    // no subpixel anti-aliasing because we are on transparent BG
-    cairo_font_options_t *font_options = cairo_font_options_create();
-    if (xshape_mask == 0)
+
+    size_t len = strlen(subtitle) + 1;
+    if (len > r->size)
     {
-        cairo_font_options_set_antialias(font_options, CAIRO_ANTIALIAS_GRAY);
+        char *buffer = realloc(r->subtitle, 2 * len);
+        if (!buffer)
+        {
+            return;
+        }
+        r->subtitle = buffer;
+        r->lines = buffer + len;
+        r->size = len;
     }
     else
     {
-        cairo_font_options_set_antialias(font_options, CAIRO_ANTIALIAS_NONE);
+        r->lines = r->subtitle + r->size;
+    }
+    memcpy(r->subtitle, subtitle, len);
+    memcpy(r->lines, subtitle, len);
+
+    char *new_line_ptr = strchr(r->lines, '\n');
+    r->second_line = NULL;
+    if (new_line_ptr)
+    {
+        *new_line_ptr = '\0';
+        r->second_line = new_line_ptr + 1;
+    }
+}
+
+int text_renderer_draw(text_renderer_t *const r, cairo_t *const cr, const char *const title,
+                       const char *const subtitle, int xshape_mask)
+{
+    cairo_scaled_font_t **fonts = r->fonts[xshape_mask == 0];
+
+    if (title)
+    {
+        cairo_set_scaled_font(cr, fonts[0]);
+        cairo_move_to(cr, 20, 30 * r->scale);
+        cairo_show_text(cr, title);
     }
-    cairo_set_font_options(cr, font_options);
 
-    // set font size, and scale up or down
-    cairo_set_font_size(cr, 24 * options.scale);
+    if (!subtitle)
+    {
+        return 0;
+    }
+    split_subtitle(r, subtitle);
+    if (!r->lines)
+    {
+        return 0;
+    }
+    cairo_set_scaled_font(cr, fonts[1]);
+    cairo_move_to(cr, 20, 55 * r->scale);
+    cairo_show_text(cr, r->lines);
+    if (!r->second_line)
+    {
+        return 1;
+    }
+    cairo_move_to(cr, 20, 75 * r->scale);
+    cairo_show_text(cr, r->second_line);
+    return 2;
+}
 
-    // font weight and slant settings
-    cairo_font_weight_t font_weight = CAIRO_FONT_WEIGHT_NORMAL;
-    if (options.bold_mode)
+void text_renderer_free(text_renderer_t *const r)
+{
+    if (!r)
+    {
+        return;
+    }
+    for (int antialias = 0; antialias < 2; antialias++)
     {
-        font_weight = CAIRO_FONT_WEIGHT_BOLD;
+        for (int i = 0; i < 2; i++)
+        {
+            if (r->fonts[antialias][i])
+            {
+                cairo_scaled_font_destroy(r->fonts[antialias][i]);
+            }
+        }
     }
+    if (r->face)
+    {
+        cairo_font_face_destroy(r->face);
+    }
+    free(r->subtitle);
+    free(r->font);
+    free(r);
+}
 
-    cairo_font_slant_t font_slant = CAIRO_FONT_SLANT_NORMAL;
-    if (options.italic_mode)
+text_renderer_t *text_renderer_current(void)
+{
+    for (int i = 0; i < TEXT_RENDERERS; i++)
     {
-        font_slant = CAIRO_FONT_SLANT_ITALIC;
+        if (renderers[i] && text_renderer_matches(renderers[i], &options, options.scale))
+        {
+            return renderers[i];
+        }
     }
 
-    cairo_select_font_face(cr, options.custom_font, font_slant, font_weight);
+    text_renderer_free(renderers[oldest]);
+    renderers[oldest] = text_renderer_new(&options, options.scale);
+    text_renderer_t *r = renderers[oldest];
+    oldest = (oldest + 1) % TEXT_RENDERERS;
+    return r;
+}
 
-    cairo_move_to(cr, 20, 30 * options.scale);
-    cairo_show_text(cr, options.title);
+void draw_text_region(cairo_t *const cr, text_region_t region)
+{
+    cairo_save(cr);
+    cairo_set_operator(cr, CAIRO_OPERATOR_CLEAR);
+    cairo_paint(cr);
+    cairo_restore(cr);
 
-    cairo_set_font_size(cr, 16 * options.scale);
-    cairo_move_to(cr, 20, 55 * options.scale);
+    cairo_set_source_rgba(cr, options.text_color.r, options.text_color.g, options.text_color.b,
+                          options.text_color.a);
+    text_renderer_t *renderer = text_renderer_current();
+    if (region == TEXT_REGION_TITLE)
+    {
+        if (renderer)
+        {
+            text_renderer_draw(renderer, cr, options.title, NULL, 0);
+        }
+        return;
+    }
 
-    // handle string with \n as cairo cannot do it out of the box
-    char *subtitle = options.subtitle;
-    char *new_line_ptr = strchr(subtitle, '\n');
-    if (new_line_ptr)
+    int lines = renderer ? text_renderer_draw(renderer, cr, NULL, options.subtitle, 0) : 1;
+    if (options.sparkline_hours > 0)
     {
-        size_t first_line_len = new_line_ptr - subtitle;
-        char *first_line = calloc(1, first_line_len + 1);
-        memcpy(first_line, subtitle, first_line_len);
-        cairo_show_text(cr, first_line);
-        free(first_line);
+        sparkline_draw(cr, 20, (lines > 1 ? 82 : 62) * options.scale);
+    }
+}
 
-        cairo_move_to(cr, 20, 75 * options.scale);
-        cairo_show_text(cr, new_line_ptr + 1);
+void draw_text(cairo_t *const cr, int xshape_mask)
+{
+    // a cached frame of the shown symbol replaces the whole pass
+    if (options.display_mode == DISPLAY_ROTATE && rotation_draw(cr, xshape_mask))
+    {
+        return;
+    }
+
+    // clear surface
+    cairo_operator_t prev_operator = cairo_get_operator(cr);
+    cairo_set_operator(cr, CAIRO_OPERATOR_CLEAR);
+    cairo_paint(cr);
+    if (xshape_mask == 0)
+    {
+        cairo_set_operator(cr, prev_operator);
+    }
+
+    // set text color
+    if (xshape_mask == 0)
+    {
+        cairo_set_source_rgba(cr, options.text_color.r, options.text_color.g, options.text_color.b,
+                              options.text_color.a);
     }
     else
     {
-        cairo_show_text(cr, subtitle);
+        cairo_set_operator(cr, CAIRO_OPERATOR_OVER);
+    }
+    
+    // the tape brings its own per-symbol colors
+    if (options.display_mode == DISPLAY_TICKER)
+    {
+        ticker_draw(cr, options.overlay_width * options.scale);
+        return;
     }
 
-    cairo_font_options_destroy(font_options);
+    // cheap hack for xshape
+    if (xshape_mask == 2)
+    {
+        cairo_set_source_rgb(cr, options.text_color.r, options.text_color.g, options.text_color.b);
+        cairo_paint(cr);
+        return;
+    }
+    
+    text_renderer_t *renderer = text_renderer_current();
+    int lines = renderer ? text_renderer_draw(renderer, cr, options.title, options.subtitle, xshape_mask) : 1;
+
+    // price history below the subtitle, drawn with the text color
+    if (options.sparkline_hours > 0)
+    {
+        sparkline_draw(cr, 20, (lines > 1 ? 82 : 62) * options.scale);
+    }
 }
 
 #endif
@@ -1,7 +1,99 @@
 #ifndef INCLUDE_DRAW_H
 #define INCLUDE_DRAW_H
 
+#include <stdbool.h>
 #include <cairo/cairo.h>
+#include "options.h"
+
+/**
+ * Struct holding what drawing the overlay text needs across frames: the
+ * resolved font face, its scaled fonts and the split subtitle.
+ */
+typedef struct text_renderer_t text_renderer_t;
+
+/**
+ * Creates a renderer for the font and style of `options'.
+ *
+ * The font face is resolved once, and the title and subtitle sizes get
+ * their scaled fonts right away, so frames neither look up the font nor
+ * switch sizes.
+ *
+ * @param options The options with font, bold and italic settings.
+ * @param scale   The scale the text is drawn at.
+ *
+ * @returns The renderer, or NULL if it cannot be created.
+ */
+text_renderer_t *text_renderer_new(const Options *const options, double scale);
+
+/**
+ * @returns Whether the renderer was made for the font and style of
+ *          `options' at `scale'.
+ */
+bool text_renderer_matches(const text_renderer_t *const r, const Options *const options, double scale);
+
+/**
+ * @param r         The renderer.
+ * @param antialias Whether the glyphs are anti-aliased, which XShape masks
+ *                  are not.
+ *
+ * @returns The scaled font of the title, owned by the renderer.
+ */
+cairo_scaled_font_t *text_renderer_title_font(text_renderer_t *const r, bool antialias);
+
+/**
+ * Draws a title and a subtitle of up to two lines, in the current source
+ * of `cr'.
+ *
+ * @param r           The renderer.
+ * @param cr          The context, translated at most.
+ * @param title       The title, or NULL to leave it out.
+ * @param subtitle    The subtitle, whose first newline starts a second line,
+ *                    or NULL to leave it out.
+ * @param xshape_mask Non-zero when drawing an XShape mask.
+ *
+ * @returns The number of subtitle lines drawn.
+ */
+int text_renderer_draw(text_renderer_t *const r, cairo_t *const cr, const char *const title,
+                       const char *const subtitle, int xshape_mask);
+
+/**
+ * Releases a renderer and its fonts.
+ */
+void text_renderer_free(text_renderer_t *const r);
+
+/**
+ * @returns The renderer shared by all backends for the font, style and
+ *          scale in `options'. The last few are kept, so outputs drawn at
+ *          different scales do not make them again every frame.
+ */
+text_renderer_t *text_renderer_current(void);
+
+/**
+ * Parts of the static overlay that change independently: the title with
+ * the price, and the subtitle with symbol, time and sparkline.
+ */
+typedef enum {
+    TEXT_REGION_TITLE,
+    TEXT_REGION_SUBTITLE,
+    TEXT_REGIONS
+} text_region_t;
+
+/**
+ * Where the subtitle region starts, before scaling. The title region is
+ * above it.
+ */
+#define TEXT_SUBTITLE_TOP 38
+
+/**
+ * Draws one region of the static overlay, in overlay coordinates. The
+ * caller translates `cr' so that the region lands on its surface; all of
+ * the surface is cleared first.
+ *
+ * @param cr     The context.
+ * @param region The region.
+ */
+void draw_text_region(cairo_t *const cr, text_region_t region);
+
 void draw_text(cairo_t *const cr, int xshape_mask);
 
 #endif
@@ -1,10 +1,181 @@
 #include <libconfig.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#ifdef __linux__
+  #include <sys/inotify.h>
+#endif
 #include "log.h"
 #include "options.h"
-#include "stdlib.h"
+#include "config.h"
 #include "i18n.h"
+#include "bars.h"
+#include "symbols.h"
+#include "alerts.h"
+#include "control.h"
+#ifdef X11
+  #include "routes.h"
+#endif
 
-void load_config(const char *const file) {
+// the config file in use, and the options as they were before it was
+// applied; a reload starts over from there so that keys removed from the
+// file fall back to their previous value, then applies the file and the
+// command line options that followed it, as at startup
+static char *config_path = NULL;
+static Options config_base;
+
+// memory for the values read from a file. The snapshot replaced by a reload
+// still points into the previous generation, which is therefore kept until
+// the next reload
+typedef struct config_block_t {
+  struct config_block_t *next;
+  void *data[];
+} config_block_t;
+
+static config_block_t *generations[2] = {NULL, NULL};
+static int generation = 0;
+
+static void *config_alloc(size_t size) {
+  config_block_t *block = malloc(sizeof(config_block_t) + size);
+  if (!block) {
+    __error__("Cannot allocate memory for config values\n");
+    exit(EXIT_FAILURE);
+  }
+  block->next = generations[generation];
+  generations[generation] = block;
+  return block->data;
+}
+
+static char *config_strdup(const char *const src) {
+  return strcpy(config_alloc(strlen(src) + 1), src);
+}
+
+static void config_free_generation(int which) {
+  while (generations[which]) {
+    config_block_t *next = generations[which]->next;
+    free(generations[which]);
+    generations[which] = next;
+  }
+}
+
+// Accepts numbers written with or without a decimal point
+static bool setting_number(const config_setting_t *setting, const char *const name, double *value) {
+  int itmp;
+  if (config_setting_lookup_float(setting, name, value) != CONFIG_FALSE) {
+    return true;
+  }
+  if (config_setting_lookup_int(setting, name, &itmp) != CONFIG_FALSE) {
+    *value = itmp;
+    return true;
+  }
+  return false;
+}
+
+// Indexes the `alerts' list, e.g.
+//   alerts = ( { symbol = "ES1"; crosses = 5000.0; },
+//              { symbol = "SP500"; change-below = -1.5; hold = 300; },
+//              { symbol = "NQ1"; move = 50.0; minutes = 5; } );
+// A file without it drops the rules of the previous one.
+static void read_alerts(config_t *cf) {
+  config_setting_t *list = config_lookup(cf, "alerts");
+  int length = list ? config_setting_length(list) : 0;
+  alert_rule_t *rules = malloc((length > 0 ? length : 1) * sizeof(alert_rule_t));
+  if (!rules) {
+    __error__("Cannot allocate %d alert rules\n", length);
+    return;
+  }
+
+  int count = 0;
+  for (int i = 0; i < length; i++) {
+    config_setting_t *entry = config_setting_get_elem(list, i);
+    alert_rule_t *r = &rules[count];
+    const char *symbol;
+    if (config_setting_lookup_string(entry, "symbol", &symbol) == CONFIG_FALSE || strlen(symbol) >= SYMBOL_NAME_LEN) {
+      __error__("Ignoring alert #%d in config without a valid symbol\n", i + 1);
+      continue;
+    }
+    strcpy(r->symbol, symbol);
+
+    int kinds = 0;
+    for (int kind = ALERT_ABOVE; kind <= ALERT_MOVE; kind++) {
+      if (setting_number(entry, alerts_kind_name(kind), &r->threshold)) {
+        r->kind = kind;
+        kinds++;
+      }
+    }
+    int minutes = 0;
+    config_setting_lookup_int(entry, "minutes", &minutes);
+    r->minutes = minutes;
+    if (kinds != 1 || (r->kind == ALERT_MOVE && (minutes < 1 || minutes > ALERT_MOVE_MINUTES))) {
+      __error__("Ignoring alert #%d in config, it needs one of above, below, crosses, change-above, "
+                "change-below or move, and a move 1 to %d minutes\n", i + 1, ALERT_MOVE_MINUTES);
+      continue;
+    }
+
+    if (!setting_number(entry, "hold", &r->hold) || r->hold < 0) {
+      r->hold = 60;
+    }
+    count++;
+  }
+
+  alerts_set(rules, count);
+  free(rules);
+}
+
+#ifdef X11
+// Routes symbols to outputs with the `outputs' list, e.g.
+//   outputs = ( { name = "DP-1"; symbols = [ "ES1", "NQ1" ]; },
+//               { name = "HDMI-1"; symbols = [ "SP500", "CL*" ]; } );
+// A file without it shows all symbols on every output again.
+static void read_routes(config_t *cf) {
+  config_setting_t *list = config_lookup(cf, "outputs");
+  int length = list ? config_setting_length(list) : 0;
+  route_spec_t routes[ROUTES_MAX];
+  const char **symbols[ROUTES_MAX];
+  int count = 0;
+  for (int i = 0; i < length && count < ROUTES_MAX; i++) {
+    config_setting_t *entry = config_setting_get_elem(list, i);
+    config_setting_t *names = config_setting_get_member(entry, "symbols");
+    const char *name;
+    if (config_setting_lookup_string(entry, "name", &name) == CONFIG_FALSE || names == NULL) {
+      __error__("Ignoring output #%d in config, it needs a name and symbols\n", i + 1);
+      continue;
+    }
+
+    int symbol_count = config_setting_length(names);
+    symbols[count] = malloc((symbol_count > 0 ? symbol_count : 1) * sizeof(char *));
+    if (!symbols[count]) {
+      __error__("Cannot allocate the symbols of output %s\n", name);
+      continue;
+    }
+    routes[count].output = name;
+    routes[count].symbols = symbols[count];
+    routes[count].symbol_count = 0;
+    for (int j = 0; j < symbol_count; j++) {
+      const char *symbol = config_setting_get_string_elem(names, j);
+      if (symbol == NULL) {
+        __error__("Ignoring invalid symbol #%d of output %s in config\n", j + 1, name);
+        continue;
+      }
+      symbols[count][routes[count].symbol_count++] = symbol;
+    }
+    count++;
+  }
+  if (length > ROUTES_MAX) {
+    __error__("Only the first %d outputs in config get their own symbols\n", ROUTES_MAX);
+  }
+
+  routes_set(routes, count);
+  for (int i = 0; i < count; i++) {
+    free(symbols[i]);
+  }
+}
+#endif
+
+// Reads `file' into `o'. On reload, keys only meaningful at startup are
+// skipped, and errors are reported instead of terminating.
+static bool read_config(const char *const file, Options *o, bool reload) {
   __debug__("Loading config from \"%s\"\n", file);
   config_t cfg, *cf;
   const char *tmp;
@@ -20,95 +191,348 @@ void load_config(const char *const file) {
   if (config_read_file(cf, file) == CONFIG_FALSE) {
     __error__("Config load failed. %s:%d - %s\n", config_error_file(cf), config_error_line(cf), config_error_text(cf));
     config_destroy(cf);
-    exit(EXIT_FAILURE);
+    return false;
   }
 
   __debug__("Config read successfully\n");
 
-  if (config_lookup_string(cf, "text-title", &tmp) != CONFIG_FALSE) {
-    options.title = malloc(strlen(tmp) + 1);
-    strcpy(options.title, tmp);
+  // once running, title and message show the quotes
+  if (!reload && config_lookup_string(cf, "text-title", &tmp) != CONFIG_FALSE) {
+    o->title = malloc(strlen(tmp) + 1);
+    strcpy(o->title, tmp);
   }
 
-  if (config_lookup_string(cf, "text-message", &tmp) != CONFIG_FALSE) {
-    options.subtitle = malloc(strlen(tmp) + 1);
-    strcpy(options.subtitle, tmp);
+  if (!reload && config_lookup_string(cf, "text-message", &tmp) != CONFIG_FALSE) {
+    o->subtitle = malloc(strlen(tmp) + 1);
+    strcpy(o->subtitle, tmp);
   }
 
   if (config_lookup_string(cf, "text-font", &tmp) != CONFIG_FALSE) {
-    options.custom_font = malloc(strlen(tmp) + 1);
-    strcpy(options.custom_font, tmp);
+    o->custom_font = config_strdup(tmp);
   }
 
   if (config_lookup_bool(cf, "text-bold", &itmp) != CONFIG_FALSE) {
-    options.bold_mode = (bool)itmp;
+    o->bold_mode = (bool)itmp;
   }
 
   if (config_lookup_bool(cf, "text-italic", &itmp) != CONFIG_FALSE) {
-    options.italic_mode = (bool)itmp;
+    o->italic_mode = (bool)itmp;
   }
 
   if (config_lookup_bool(cf, "bypass-compositor", &itmp) != CONFIG_FALSE) {
-    options.bypass_compositor = (bool)itmp;
+    o->bypass_compositor = (bool)itmp;
   }
 
   if (config_lookup_bool(cf, "gamescope", &itmp) != CONFIG_FALSE) {
-    options.gamescope_overlay = (bool)itmp;
+    o->gamescope_overlay = (bool)itmp;
   }
 
   if (config_lookup_float(cf, "text-color-r", &ftmp) == CONFIG_FALSE) {
-    ftmp = options.text_color.r;
+    ftmp = o->text_color.r;
   }
 
   if (config_lookup_float(cf, "text-color-g", &ftmpa) == CONFIG_FALSE) {
-    ftmpa = options.text_color.g;
+    ftmpa = o->text_color.g;
   }
 
   if (config_lookup_float(cf, "text-color-b", &ftmpb) == CONFIG_FALSE) {
-    ftmpb = options.text_color.b;
+    ftmpb = o->text_color.b;
   }
 
   if (config_lookup_float(cf, "text-color-a", &ftmpc) == CONFIG_FALSE) {
-    ftmpc = options.text_color.a;
+    ftmpc = o->text_color.a;
   }
 
-  options.text_color = rgba_color_new((float)ftmp, (float)ftmpa, (float)ftmpb, (float)ftmpc);
+  o->text_color = rgba_color_new((float)ftmp, (float)ftmpa, (float)ftmpb, (float)ftmpc);
 
   if (config_lookup_float(cf, "scale", &ftmp) != CONFIG_FALSE) {
-    options.scale = ftmp;
+    o->scale = ftmp;
+  }
+
+  if (config_lookup_float(cf, "sparkline", &ftmp) != CONFIG_FALSE) {
+    o->sparkline_hours = ftmp;
+  }
+
+  if (config_lookup_string(cf, "bars", &tmp) != CONFIG_FALSE) {
+    o->bar_period = bars_parse_period(tmp);
+    if (o->bar_period < 0) {
+      __error__("Unknown bar period \"%s\" in config\n", tmp);
+    }
+  }
+
+  if (config_lookup_bool(cf, "analytics", &itmp) != CONFIG_FALSE) {
+    o->analytics = (bool)itmp;
+  }
+
+  if (config_lookup_bool(cf, "zscore-color", &itmp) != CONFIG_FALSE) {
+    o->zscore_color = (bool)itmp;
+  }
+
+  if (config_lookup_string(cf, "session-start", &tmp) != CONFIG_FALSE) {
+    itmp = parse_session_start(tmp);
+    if (itmp < 0) {
+      __error__("Cannot parse session start \"%s\" in config\n", tmp);
+    } else {
+      o->session_start = itmp;
+    }
+  }
+
+  if (config_lookup_string(cf, "display", &tmp) != CONFIG_FALSE) {
+    itmp = parse_display_mode(tmp);
+    if (itmp < 0) {
+      __error__("Unknown display mode \"%s\" in config\n", tmp);
+    } else {
+      o->display_mode = itmp;
+    }
+  }
+
+  if (config_lookup_float(cf, "ticker-speed", &ftmp) != CONFIG_FALSE) {
+    o->ticker_speed = ftmp;
+  }
+
+  if (config_lookup_float(cf, "rotate-interval", &ftmp) != CONFIG_FALSE && ftmp > 0) {
+    o->rotate_interval = ftmp;
+  }
+
+  if (config_lookup_int(cf, "frame-cache", &itmp) != CONFIG_FALSE && itmp >= 0) {
+    o->frame_cache_kb = itmp;
+  }
+
+  if (config_lookup_float(cf, "flash", &ftmp) != CONFIG_FALSE && ftmp >= 0) {
+    o->flash_seconds = ftmp;
+  }
+
+  if (config_lookup_int(cf, "animation-fps", &itmp) != CONFIG_FALSE && itmp > 0) {
+    o->animation_fps = itmp;
+  }
+
+  if (config_lookup_float(cf, "animation-budget", &ftmp) != CONFIG_FALSE && ftmp > 0 && ftmp <= 100) {
+    o->animation_budget = ftmp;
   }
 
   if (config_lookup_int(cf, "overlay-width", &itmp) != CONFIG_FALSE) {
-    options.overlay_width = itmp;
+    o->overlay_width = itmp;
   }
 
   if (config_lookup_int(cf, "overlay-height", &itmp) != CONFIG_FALSE) {
-    options.overlay_height = itmp;
+    o->overlay_height = itmp;
+  }
+
+  config_setting_t *symbols = config_lookup(cf, "symbols");
+  if (symbols != NULL) {
+    int length = config_setting_length(symbols);
+    char **channels = config_alloc((length > 0 ? length : 1) * sizeof(char *));
+    int count = 0;
+    for (int i = 0; i < length && count < SYMBOLS_MAX; i++) {
+      tmp = config_setting_get_string_elem(symbols, i);
+      if (tmp == NULL || strlen(tmp) >= SYMBOL_NAME_LEN) {
+        __error__("Ignoring invalid symbol #%d in config\n", i + 1);
+        continue;
+      }
+      channels[count++] = config_strdup(tmp);
+    }
+    if (count > 0) {
+      o->channels = channels;
+      o->channel_count = count;
+    }
+  }
+
+  read_alerts(cf);
+#ifdef X11
+  read_routes(cf);
+#endif
+
+  // the feed is set up once at startup
+  if (!reload && config_lookup_string(cf, "host", &tmp) != CONFIG_FALSE) {
+    o->host = strdup(tmp);
+  }
+
+  if (!reload && config_lookup_int(cf, "port", &itmp) != CONFIG_FALSE) {
+    if (itmp <= 0 || itmp > 65535) {
+      __error__("Invalid port %d in config\n", itmp);
+    } else {
+      o->port = itmp;
+    }
+  }
+
+  if (!reload && config_lookup_string(cf, "redis-socket", &tmp) != CONFIG_FALSE) {
+    o->redis_socket = strdup(tmp);
+  }
+
+  if (!reload && config_lookup_int(cf, "keepalive", &itmp) != CONFIG_FALSE && itmp >= 0) {
+    o->keepalive = itmp;
   }
 
-  if (config_lookup_bool(cf, "daemonize", &itmp) != CONFIG_FALSE) {
-    options.daemonize = (bool)itmp;
+  if (!reload && config_lookup_int(cf, "receive-buffer", &itmp) != CONFIG_FALSE && itmp >= 0) {
+    o->receive_buffer_kb = itmp;
+  }
+
+  if (!reload && config_lookup_bool(cf, "cluster", &itmp) != CONFIG_FALSE) {
+    o->cluster = (bool)itmp;
+  }
+
+  if (!reload && config_lookup_string(cf, "quote-board", &tmp) != CONFIG_FALSE) {
+    itmp = parse_board_mode(tmp);
+    if (itmp < 0) {
+      __error__("Unknown quote board mode \"%s\" in config\n", tmp);
+    } else {
+      o->board_mode = itmp;
+    }
+  }
+
+  if (!reload && config_lookup_bool(cf, "daemonize", &itmp) != CONFIG_FALSE) {
+    o->daemonize = (bool)itmp;
   }
 #ifdef X11
   if (config_lookup_bool(cf, "force-xshape", &itmp) != CONFIG_FALSE) {
-    options.force_xshape = (bool)itmp;
+    o->force_xshape = (bool)itmp;
+  }
+
+  if (config_lookup_string(cf, "monitors", &tmp) != CONFIG_FALSE) {
+    o->monitors = config_strdup(tmp);
   }
 #endif
-  if (config_lookup_bool(cf, "verbose", &itmp) != CONFIG_FALSE) {
+  if (!reload && config_lookup_bool(cf, "verbose", &itmp) != CONFIG_FALSE) {
     if (itmp) {
       inc_verbose();
     }
   }
 
-  if (config_lookup_bool(cf, "quiet", &itmp) != CONFIG_FALSE) {
+  if (!reload && config_lookup_bool(cf, "quiet", &itmp) != CONFIG_FALSE) {
     if (itmp) {
       set_silent();
     }
   }
 
-  if (config_lookup_string(cf, "text-preset", &tmp) != CONFIG_FALSE) {
+  if (!reload && config_lookup_string(cf, "text-preset", &tmp) != CONFIG_FALSE) {
     i18n_set_info(tmp);
   }
 
   config_destroy(cf);
+  return true;
 }
+
+void load_config(const char *const file) {
+  if (config_path == NULL) {
+    config_base = options;
+  }
+  free(config_path);
+  config_path = strdup(file);
+
+  if (!read_config(file, &options, false)) {
+    exit(EXIT_FAILURE);
+  }
+}
+
+int reload_config(Options *previous) {
+  if (config_path == NULL) {
+    return -1;
+  }
+
+  Options next = config_base;
+
+  // frees the generation two reloads back, nothing points there anymore
+  generation ^= 1;
+  config_free_generation(generation);
+
+  if (!read_config(config_path, &next, true)) {
+    __error__("Keeping the running configuration\n");
+    config_free_generation(generation);
+    generation ^= 1;
+    return -1;
+  }
+  options_reapply(&next);
+
+  // the quote on display is state, not configuration
+  next.title = options.title;
+  next.subtitle = options.subtitle;
+  next.text_color = options.text_color;
+  // and the feed keeps the settings it was started with
+  next.host = options.host;
+  next.port = options.port;
+  next.redis_socket = options.redis_socket;
+  next.keepalive = options.keepalive;
+  next.receive_buffer_kb = options.receive_buffer_kb;
+  next.cluster = options.cluster;
+  next.board_mode = options.board_mode;
+  next.daemonize = options.daemonize;
+#ifdef CAIRO
+  // and symbols subscribed to through the control socket stay
+  int count;
+  char **channels = control_channels(&count);
+  if (channels) {
+    next.channels = channels;
+    next.channel_count = count;
+  }
+#endif
+
+  // the backends are single threaded, so swapping the whole snapshot between
+  // two iterations of their event loop never exposes a partial configuration
+  *previous = options;
+  options = next;
+  __info__("Reloaded config from \"%s\"\n", config_path);
+  return 0;
+}
+
+#ifdef __linux__
+int config_watch(void) {
+  if (config_path == NULL) {
+    return -1;
+  }
+
+  int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (fd < 0) {
+    __perror__("Cannot watch config file");
+    return -1;
+  }
+
+  // editors commonly write a new file and rename it over the old one, so
+  // the directory is watched rather than the file itself
+  char *dir = strdup(config_path);
+  char *slash = strrchr(dir, '/');
+  if (slash == NULL) {
+    strcpy(dir, ".");
+  } else if (slash == dir) {
+    slash[1] = '\0';
+  } else {
+    *slash = '\0';
+  }
+
+  if (inotify_add_watch(fd, dir, IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+    __perror__("Cannot watch config file");
+    close(fd);
+    fd = -1;
+  } else {
+    __debug__("Watching \"%s\" for config changes\n", dir);
+  }
+  free(dir);
+  return fd;
+}
+
+bool config_changed(int fd) {
+  const char *name = strrchr(config_path, '/');
+  name = name ? name + 1 : config_path;
+
+  char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+  bool changed = false;
+  ssize_t len;
+  while ((len = read(fd, buf, sizeof(buf))) > 0) {
+    for (char *p = buf; p < buf + len; p += sizeof(struct inotify_event) + ((struct inotify_event *)p)->len) {
+      const struct inotify_event *event = (const struct inotify_event *)p;
+      if (event->len > 0 && strcmp(event->name, name) == 0) {
+        changed = true;
+      }
+    }
+  }
+  return changed;
+}
+#else
+int config_watch(void) {
+  return -1;
+}
+
+bool config_changed(int fd) {
+  (void)fd;
+  return false;
+}
+#endif
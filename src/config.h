@@ -1,6 +1,49 @@
 #ifndef INCLUDE_CONFIG_H
 #define INCLUDE_CONFIG_H
 
+#include <stdbool.h>
+#include "options.h"
+
+/**
+ * Applies a config file to the global options, terminating on errors.
+ * The file is remembered for reload_config().
+ *
+ * @param file The path of the config file.
+ */
 void load_config(const char *const file);
 
+/**
+ * Re-reads the config file into a fresh options snapshot and swaps it in.
+ *
+ * The snapshot starts from the options as they were before the file was
+ * first applied, so keys removed from the file fall back, and command line
+ * options given after the file still override it. Title, message, preset,
+ * quote board, verbosity and daemonize only apply at startup, and symbols
+ * changed through the control socket stay. On errors the running options
+ * are left alone.
+ *
+ * @param previous Receives the options replaced by the swap; they stay
+ *                 valid until the next reload.
+ *
+ * @returns 0 if the new options are in effect, -1 otherwise.
+ */
+int reload_config(Options *previous);
+
+/**
+ * Starts watching the loaded config file for changes.
+ *
+ * @returns A descriptor that becomes readable on changes, for
+ *          config_changed(), or -1 if no config file is in use.
+ */
+int config_watch(void);
+
+/**
+ * Drains the change notifications of the config file watch.
+ *
+ * @param fd The descriptor returned by config_watch().
+ *
+ * @returns true if the config file was written or replaced.
+ */
+bool config_changed(int fd);
+
 #endif
@@ -0,0 +1,383 @@
+#ifdef CAIRO
+
+#define _GNU_SOURCE     // for struct ucred
+#include <errno.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "control.h"
+#include "log.h"
+#include "options.h"
+#include "redis.h"
+#include "stock.h"
+#include "alerts.h"
+#include "symbols.h"
+
+control_stats_t control_stats = {0};
+
+#ifdef __linux__
+
+// longest request, e.g. a subscribe with many symbols
+#define CONTROL_REQUEST_MAX 4096
+// answers are split into datagrams of at most this size
+#define CONTROL_REPLY_MAX 4096
+
+typedef struct {
+  int fd;
+  struct sockaddr_un addr;
+  socklen_t addr_len;
+  char buf[CONTROL_REPLY_MAX];
+  size_t used;
+} control_reply_t;
+
+static double started = 0;
+
+// channel list set through `subscribe' and `unsubscribe', names included
+static char **owned_channels = NULL;
+static int owned_count = 0;
+
+static double monotonic_seconds(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// abstract socket name of this user's instance
+static socklen_t control_address(struct sockaddr_un *addr) {
+  memset(addr, 0, sizeof(*addr));
+  addr->sun_family = AF_UNIX;
+  int len = snprintf(addr->sun_path + 1, sizeof(addr->sun_path) - 1, "activate-linux-%u", (unsigned)getuid());
+  return offsetof(struct sockaddr_un, sun_path) + 1 + len;
+}
+
+static void reply_flush(control_reply_t *r) {
+  // never wait for a client that does not read its answer
+  if (sendto(r->fd, r->buf, r->used, MSG_DONTWAIT, (struct sockaddr *)&r->addr, r->addr_len) < 0) {
+    __debug__("Dropping control answer: %s\n", strerror(errno));
+  }
+  r->used = 0;
+}
+
+#ifdef __GNUC__
+__attribute__((format(printf, 2, 3)))
+#endif
+static void reply_printf(control_reply_t *r, const char *fmt, ...) {
+  char line[256];
+  va_list args;
+  va_start(args, fmt);
+  int len = vsnprintf(line, sizeof(line), fmt, args);
+  va_end(args);
+  if (len < 0) {
+    return;
+  }
+  if ((size_t)len >= sizeof(line)) {
+    len = sizeof(line) - 1;
+  }
+  if (r->used + len > sizeof(r->buf)) {
+    reply_flush(r);
+  }
+  memcpy(r->buf + r->used, line, len);
+  r->used += len;
+}
+
+// swaps in a new channel list and lets Redis follow the difference
+static void set_channels(char *const names[], int count) {
+  size_t size = count * sizeof(char *);
+  for (int i = 0; i < count; i++) {
+    size += strlen(names[i]) + 1;
+  }
+  char **list = malloc(size > 0 ? size : 1);
+  if (!list) {
+    __error__("Cannot allocate channel list\n");
+    return;
+  }
+  char *p = (char *)(list + count);
+  for (int i = 0; i < count; i++) {
+    list[i] = strcpy(p, names[i]);
+    p += strlen(p) + 1;
+  }
+
+  Options previous = options;
+  options.channels = list;
+  options.channel_count = count;
+  redis_update_subscriptions(&previous);
+
+  // `names' may point into the old list, which is only released now
+  free(owned_channels);
+  owned_channels = list;
+  owned_count = count;
+}
+
+static void control_subscribe(control_reply_t *r, char *args, bool subscribe) {
+  static char *names[SYMBOLS_MAX];
+  int count = 0;
+  for (int i = 0; i < options.channel_count; i++) {
+    names[count++] = options.channels[i];
+  }
+
+  for (char *name = strtok(args, " "); name; name = strtok(NULL, " ")) {
+    if (strlen(name) >= SYMBOL_NAME_LEN) {
+      reply_printf(r, "error: symbol %s is too long\n", name);
+      return;
+    }
+
+    int found = -1;
+    for (int i = 0; i < count && found < 0; i++) {
+      if (strcmp(names[i], name) == 0) {
+        found = i;
+      }
+    }
+
+    if (subscribe && found < 0) {
+      if (count == SYMBOLS_MAX) {
+        reply_printf(r, "error: too many symbols\n");
+        return;
+      }
+      names[count++] = name;
+    } else if (!subscribe && found >= 0) {
+      count--;
+      memmove(names + found, names + found + 1, (count - found) * sizeof(char *));
+    }
+  }
+
+  set_channels(names, count);
+  reply_printf(r, "ok\n");
+}
+
+static void control_status(control_reply_t *r) {
+  const char *modes[] = {"static", "ticker", "rotate"};
+  reply_printf(r, "pid %d\n", (int)getpid());
+  reply_printf(r, "uptime %.0f\n", monotonic_seconds() - started);
+  if (options.redis_socket) {
+    reply_printf(r, "host unix:%s\n", options.redis_socket);
+  } else if (options.host && strchr(options.host, ',')) {
+    reply_printf(r, "hosts %s%s\n", options.host, options.cluster ? " (cluster)" : "");
+  } else {
+    reply_printf(r, "host %s:%d%s\n", options.host ? options.host : "127.0.0.1", options.port,
+                 options.cluster ? " (cluster)" : "");
+  }
+  reply_printf(r, "display %s\n", modes[options.display_mode]);
+  reply_printf(r, "symbols");
+  for (int i = 0; i < options.channel_count; i++) {
+    reply_printf(r, " %s", options.channels[i]);
+  }
+  reply_printf(r, "\n");
+}
+
+static void control_stats_reply(control_reply_t *r) {
+  reply_printf(r, "messages %lu\n", control_stats.messages);
+  reply_printf(r, "frames %lu\n", control_stats.frames);
+  reply_printf(r, "conflated %lu\n", control_stats.conflated);
+
+  alerts_stats_t alerts;
+  alerts_stats(&alerts);
+  if (alerts.rules > 0) {
+    reply_printf(r, "alerts %d fired %lu\n", alerts.rules, alerts.fired);
+    reply_printf(r, "alert checks per quote avg %.1f max %lu, time avg %.0f ns max %.0f ns\n",
+                 alerts.ticks ? (double)alerts.examined / alerts.ticks : 0.0, alerts.examined_max,
+                 alerts.ns_avg, alerts.ns_max);
+  }
+
+  redis_host_stats_t hosts[16];
+  int count = redis_host_stats(hosts, 16);
+  if (count > 0) {
+    reply_printf(r, "duplicates %lu\n", control_stats.duplicates);
+  }
+  for (int i = 0; i < count; i++) {
+    reply_printf(r, "host %s:%d%s first %lu late %lu lead avg %.3f ms max %.3f ms\n", hosts[i].host,
+                 hosts[i].port, hosts[i].connected ? "" : " (down)", hosts[i].first, hosts[i].late,
+                 hosts[i].lead_ms_avg, hosts[i].lead_ms_max);
+  }
+  for (int i = 0; i < options.channel_count; i++) {
+    time_t tick = stock_last_tick(options.channels[i]);
+    if (tick == 0) {
+      reply_printf(r, "%s -\n", options.channels[i]);
+      continue;
+    }
+    char when[32];
+    struct tm tm;
+    strftime(when, sizeof(when), "%Y-%m-%d %H:%M:%S", localtime_r(&tick, &tm));
+    reply_printf(r, "%s %s\n", options.channels[i], when);
+  }
+}
+
+int control_start(void) {
+  int fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (fd < 0) {
+    __perror__("Cannot create control socket");
+    return -1;
+  }
+
+  // requests carry the sender's credentials, only our own user is answered
+  int on = 1;
+  setsockopt(fd, SOL_SOCKET, SO_PASSCRED, &on, sizeof(on));
+
+  struct sockaddr_un addr;
+  socklen_t len = control_address(&addr);
+  if (bind(fd, (struct sockaddr *)&addr, len) < 0) {
+    if (errno == EADDRINUSE) {
+      __warn__("Another instance is already running, stop it with -K\n");
+    } else {
+      __perror__("Cannot bind control socket");
+    }
+    close(fd);
+    return -1;
+  }
+
+  started = monotonic_seconds();
+  __debug__("Listening for control requests on @%s\n", addr.sun_path + 1);
+  return fd;
+}
+
+int control_handle(int fd) {
+  int quit = 0;
+  control_reply_t *r = &(control_reply_t){ .fd = fd };
+  char request[CONTROL_REQUEST_MAX + 1];
+  union {
+    struct cmsghdr align;
+    char buf[CMSG_SPACE(sizeof(struct ucred))];
+  } control;
+
+  for (;;) {
+    struct iovec iov = { .iov_base = request, .iov_len = CONTROL_REQUEST_MAX };
+    struct msghdr msg = {
+      .msg_name = &r->addr, .msg_namelen = sizeof(r->addr),
+      .msg_iov = &iov, .msg_iovlen = 1,
+      .msg_control = control.buf, .msg_controllen = sizeof(control.buf),
+    };
+    ssize_t len = recvmsg(fd, &msg, MSG_DONTWAIT);
+    if (len < 0) {
+      break;
+    }
+    r->addr_len = msg.msg_namelen;
+    r->used = 0;
+
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    struct ucred cred;
+    if (!cmsg || cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_CREDENTIALS) {
+      continue;
+    }
+    memcpy(&cred, CMSG_DATA(cmsg), sizeof(cred));
+    if (cred.uid != getuid()) {
+      __warn__("Ignoring control request of uid %u\n", (unsigned)cred.uid);
+      continue;
+    }
+
+    request[len] = '\0';
+    request[strcspn(request, "\r\n")] = '\0';
+    char *args = strchr(request, ' ');
+    if (args) {
+      *args++ = '\0';
+    }
+    __info__("Control request: %s\n", request);
+
+    if (strcmp(request, "quit") == 0) {
+      quit = 1;
+      reply_printf(r, "ok\n");
+    } else if (strcmp(request, "status") == 0) {
+      control_status(r);
+    } else if (strcmp(request, "stats") == 0) {
+      control_stats_reply(r);
+    } else if (strcmp(request, "subscribe") == 0 && args) {
+      control_subscribe(r, args, true);
+    } else if (strcmp(request, "unsubscribe") == 0 && args) {
+      control_subscribe(r, args, false);
+    } else {
+      reply_printf(r, "error: unknown request \"%s\", use quit, status, stats, "
+                   "subscribe SYM... or unsubscribe SYM...\n", request);
+    }
+
+    reply_flush(r);
+    // the empty datagram ends the answer
+    reply_flush(r);
+  }
+
+  return quit;
+}
+
+void control_stop(int fd) {
+  if (fd >= 0) {
+    close(fd);
+  }
+}
+
+char **control_channels(int *count) {
+  *count = owned_count;
+  return owned_channels;
+}
+
+int control_command(const char *const command) {
+  int fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+  if (fd < 0) {
+    __perror__("Cannot create control socket");
+    return 1;
+  }
+
+  // an autobound abstract address, so the instance can answer
+  struct sockaddr_un self = { .sun_family = AF_UNIX };
+  struct timeval timeout = { 2, 0 };
+  if (bind(fd, (struct sockaddr *)&self, sizeof(sa_family_t)) < 0 ||
+      setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)) < 0) {
+    __perror__("Cannot bind control socket");
+    close(fd);
+    return 1;
+  }
+
+  struct sockaddr_un addr;
+  socklen_t len = control_address(&addr);
+  if (sendto(fd, command, strlen(command), 0, (struct sockaddr *)&addr, len) < 0) {
+    __error__("No running instance found\n");
+    close(fd);
+    return 1;
+  }
+
+  char buf[CONTROL_REPLY_MAX];
+  ssize_t got;
+  while ((got = recv(fd, buf, sizeof(buf), 0)) > 0) {
+    fwrite(buf, 1, got, stdout);
+  }
+  close(fd);
+
+  if (got < 0) {
+    __error__("No answer from the running instance\n");
+    return 1;
+  }
+  return 0;
+}
+
+#else
+
+int control_start(void) {
+  return -1;
+}
+
+int control_handle(int fd) {
+  (void)fd;
+  return 0;
+}
+
+void control_stop(int fd) {
+  (void)fd;
+}
+
+char **control_channels(int *count) {
+  *count = 0;
+  return NULL;
+}
+
+int control_command(const char *const command) {
+  (void)command;
+  __error__("The control socket is only available on Linux\n");
+  return 1;
+}
+
+#endif
+
+#endif
@@ -0,0 +1,75 @@
+#ifndef INCLUDE_CONTROL_H
+#define INCLUDE_CONTROL_H
+
+/**
+ * Counters reported by the `stats' control command.
+ */
+typedef struct control_stats_t {
+  // quotes received from Redis
+  unsigned long messages;
+  // overlay updates presented on screen
+  unsigned long frames;
+  // quotes replaced by a newer one before they were drawn
+  unsigned long conflated;
+  // copies of quotes already received from another server
+  unsigned long duplicates;
+} control_stats_t;
+
+extern control_stats_t control_stats;
+
+/**
+ * Opens the control socket of this user's instance.
+ *
+ * The socket is a datagram socket in the abstract namespace, so it needs
+ * no file and vanishes with the process. It is only read when a request
+ * arrives, an idle instance pays nothing for it. Requests are single
+ * datagrams with one of
+ *
+ *   quit                    stop this instance
+ *   status                  pid, uptime, host, display mode and symbols
+ *   stats                   counters, per server arrival leads, cost of
+ *                           the alert rules and last tick per symbol
+ *   subscribe SYM...        add symbols to the subscription
+ *   unsubscribe SYM...      remove symbols from the subscription
+ *
+ * and are answered by any number of text datagrams ended by an empty one.
+ *
+ * @returns The descriptor to wait on for requests, or -1 if the socket is
+ *          unavailable, e.g. because another instance already runs.
+ */
+int control_start(void);
+
+/**
+ * Answers all pending control requests.
+ *
+ * @param fd The descriptor returned by control_start().
+ *
+ * @returns 1 if a `quit' request asked this instance to stop, 0 otherwise.
+ */
+int control_handle(int fd);
+
+/**
+ * Closes the control socket.
+ *
+ * @param fd The descriptor returned by control_start().
+ */
+void control_stop(int fd);
+
+/**
+ * @param count Receives the number of channels.
+ *
+ * @returns The channel list set by `subscribe' and `unsubscribe' requests,
+ *          or NULL while none changed it. A config reload keeps it.
+ */
+char **control_channels(int *count);
+
+/**
+ * Sends a request to the running instance and prints its answer.
+ *
+ * @param command The request, e.g. "stats".
+ *
+ * @returns 0 on success, 1 if no instance answered.
+ */
+int control_command(const char *const command);
+
+#endif
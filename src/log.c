@@ -1,25 +1,32 @@
 #include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <pthread.h>
 #include "log.h"
 
-static enum Verbosity __verbose__ = ERROR;
+enum Verbosity log_verbosity = ERROR;
 
 void inc_verbose(void) {
-  if (__verbose__ < DEBUG) __verbose__++;
+  if (log_verbosity < DEBUG) log_verbosity++;
   // Print only high levels
   if (is_verbose_level(WARN)) print_verbose_level();
 }
 
 void set_silent(void) {
-  __verbose__ = SILENT;
+  log_verbosity = SILENT;
 }
 
 bool is_verbose_level(enum Verbosity level) {
-  return level <= __verbose__;
+  return level <= log_verbosity;
 }
 
 void print_verbose_level(void) {
   char *level_str = "UNKNOWN?!";
-  switch (__verbose__) {
+  switch (log_verbosity) {
     case SILENT: level_str = "SILENT"; break;
     case ERROR:  level_str = "ERROR";  break;
     case WARN:   level_str = "WARN";   break;
@@ -28,3 +35,406 @@ void print_verbose_level(void) {
   }
   printf("Current verbosity level: %s\n", level_str);
 }
+
+// -- asynchronous writer
+//
+// Every thread that logs owns a single-producer/single-consumer ring. A
+// record is the format string pointer followed by the raw arguments in
+// 8 byte slots (strings inline, zero terminated). The writer thread walks
+// the same format string again to know how to read them back.
+
+#define LOG_RING_SIZE (256 * 1024)
+#define LOG_RECORD_MAX 1024
+#define LOG_STRING_MAX 256
+#define LOG_WRAP UINT32_MAX
+
+#define ALIGN8(n) (((n) + 7) & ~(size_t)7)
+
+typedef struct {
+  uint32_t size;        // whole record, header included, or LOG_WRAP
+  uint32_t level;
+  const char *fmt;
+} log_record_t;
+
+typedef struct log_ring_t {
+  _Atomic size_t head;  // bytes written, owner thread only
+  _Atomic size_t tail;  // bytes consumed, writer thread only
+  _Atomic unsigned long dropped;
+  struct log_ring_t *next;
+  unsigned char data[LOG_RING_SIZE];
+} log_ring_t;
+
+typedef enum {
+  ARG_NONE,
+  ARG_INT,
+  ARG_LONG,
+  ARG_LLONG,
+  ARG_SIZE,
+  ARG_PTRDIFF,
+  ARG_INTMAX,
+  ARG_DOUBLE,
+  ARG_LDOUBLE,
+  ARG_STRING,
+  ARG_POINTER
+} log_arg_t;
+
+static _Thread_local log_ring_t *own_ring = NULL;
+static log_ring_t *_Atomic rings = NULL;
+static pthread_mutex_t rings_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static pthread_t writer;
+static atomic_bool writer_running = false;
+static atomic_bool writer_stop = false;
+
+// the writer blocks on `writer_wake' while all rings are empty; producers
+// only take the lock to signal it when `writer_idle' says it may sleep
+static pthread_mutex_t writer_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t writer_wake = PTHREAD_COND_INITIALIZER;
+static atomic_bool writer_idle = false;
+
+// Parses the conversion at `fmt' (just past '%'). Returns its length and
+// stores the argument type and the number of '*' int arguments before it.
+static size_t log_spec(const char *fmt, log_arg_t *type, int *stars) {
+  const char *p = fmt;
+  int longs = 0;
+  char size = 0;
+
+  *stars = 0;
+  while (*p && strchr("-+ #0", *p)) p++;
+  if (*p == '*') { (*stars)++; p++; } else while (*p >= '0' && *p <= '9') p++;
+  if (*p == '.') {
+    p++;
+    if (*p == '*') { (*stars)++; p++; } else while (*p >= '0' && *p <= '9') p++;
+  }
+  while (*p && strchr("hlLzjt", *p)) {
+    if (*p == 'l') longs++;
+    else if (*p != 'h') size = *p;
+    p++;
+  }
+
+  switch (*p) {
+    case 'd': case 'i': case 'u': case 'x': case 'X': case 'o': case 'c':
+      *type = (size == 'z') ? ARG_SIZE : (size == 't') ? ARG_PTRDIFF : (size == 'j') ? ARG_INTMAX
+            : (longs == 1) ? ARG_LONG : (longs > 1) ? ARG_LLONG : ARG_INT;
+      break;
+    case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+      *type = (size == 'L') ? ARG_LDOUBLE : ARG_DOUBLE;
+      break;
+    case 's': *type = ARG_STRING; break;
+    case 'p': *type = ARG_POINTER; break;
+    default: *type = ARG_NONE; break;
+  }
+  return (size_t)(p - fmt) + (*p ? 1 : 0);
+}
+
+// copies the arguments of one message into `buf', returns the bytes used
+static size_t log_pack(unsigned char *buf, size_t cap, const char *fmt, va_list ap) {
+  size_t used = 0;
+  for (const char *p = fmt; *p; p++) {
+    if (*p != '%') continue;
+    log_arg_t type;
+    int stars;
+    size_t len = log_spec(p + 1, &type, &stars);
+    p += len;
+
+    for (int i = 0; i < stars; i++) {
+      if (used + 8 > cap) return used;
+      long long v = va_arg(ap, int);
+      memcpy(buf + used, &v, 8);
+      used += 8;
+    }
+
+    union { long long i; double d; void *ptr; } slot = {0};
+    switch (type) {
+      case ARG_NONE: continue;
+      case ARG_INT: slot.i = va_arg(ap, int); break;
+      case ARG_LONG: slot.i = va_arg(ap, long); break;
+      case ARG_LLONG: slot.i = va_arg(ap, long long); break;
+      case ARG_SIZE: slot.i = va_arg(ap, size_t); break;
+      case ARG_PTRDIFF: slot.i = va_arg(ap, ptrdiff_t); break;
+      case ARG_INTMAX: slot.i = va_arg(ap, intmax_t); break;
+      case ARG_DOUBLE: slot.d = va_arg(ap, double); break;
+      case ARG_POINTER: slot.ptr = va_arg(ap, void *); break;
+      case ARG_LDOUBLE: {
+        long double v = va_arg(ap, long double);
+        if (used + ALIGN8(sizeof(v)) > cap) return used;
+        memcpy(buf + used, &v, sizeof(v));
+        used += ALIGN8(sizeof(v));
+        continue;
+      }
+      case ARG_STRING: {
+        const char *s = va_arg(ap, const char *);
+        if (!s) s = "(null)";
+        size_t n = strnlen(s, LOG_STRING_MAX - 1);
+        if (used + ALIGN8(n + 1) > cap) return used;
+        memcpy(buf + used, s, n);
+        buf[used + n] = '\0';
+        used += ALIGN8(n + 1);
+        continue;
+      }
+    }
+    if (used + 8 > cap) return used;
+    memcpy(buf + used, &slot, 8);
+    used += 8;
+  }
+  return used;
+}
+
+// formats one record into `out', mirroring log_pack()
+static size_t log_unpack(char *out, size_t cap, const char *fmt, const unsigned char *args) {
+  size_t used = 0;
+  char spec[32];
+
+#define EMIT(...) do { \
+    int n = snprintf(out + used, cap - used, __VA_ARGS__); \
+    if (n > 0) used += ((size_t)n < cap - used) ? (size_t)n : cap - used - 1; \
+  } while (0)
+#define EMIT_STARS(value) do { \
+    if (stars == 0) EMIT(spec, value); \
+    else if (stars == 1) EMIT(spec, star[0], value); \
+    else EMIT(spec, star[0], star[1], value); \
+  } while (0)
+
+  for (const char *p = fmt; *p && used + 1 < cap; p++) {
+    if (*p != '%') {
+      out[used++] = *p;
+      continue;
+    }
+    if (p[1] == '%') {
+      out[used++] = '%';
+      p++;
+      continue;
+    }
+
+    log_arg_t type;
+    int stars, star[2] = {0, 0};
+    size_t len = log_spec(p + 1, &type, &stars);
+    if (len + 2 > sizeof(spec)) len = sizeof(spec) - 2;
+    memcpy(spec, p, len + 1);
+    spec[len + 1] = '\0';
+    p += len;
+
+    for (int i = 0; i < stars; i++) {
+      long long v;
+      memcpy(&v, args, 8);
+      star[i] = v;
+      args += 8;
+    }
+
+    long long i;
+    double d;
+    void *ptr;
+    switch (type) {
+      case ARG_NONE: break;
+      case ARG_INT: memcpy(&i, args, 8); args += 8; EMIT_STARS((int)i); break;
+      case ARG_LONG: memcpy(&i, args, 8); args += 8; EMIT_STARS((long)i); break;
+      case ARG_LLONG: memcpy(&i, args, 8); args += 8; EMIT_STARS(i); break;
+      case ARG_SIZE: memcpy(&i, args, 8); args += 8; EMIT_STARS((size_t)i); break;
+      case ARG_PTRDIFF: memcpy(&i, args, 8); args += 8; EMIT_STARS((ptrdiff_t)i); break;
+      case ARG_INTMAX: memcpy(&i, args, 8); args += 8; EMIT_STARS((intmax_t)i); break;
+      case ARG_DOUBLE: memcpy(&d, args, 8); args += 8; EMIT_STARS(d); break;
+      case ARG_POINTER: memcpy(&ptr, args, sizeof(ptr)); args += 8; EMIT_STARS(ptr); break;
+      case ARG_LDOUBLE: {
+        long double v;
+        memcpy(&v, args, sizeof(v));
+        args += ALIGN8(sizeof(v));
+        EMIT_STARS(v);
+        break;
+      }
+      case ARG_STRING: {
+        const char *s = (const char *)args;
+        args += ALIGN8(strlen(s) + 1);
+        EMIT_STARS(s);
+        break;
+      }
+    }
+  }
+#undef EMIT
+#undef EMIT_STARS
+  return used;
+}
+
+// writes everything queued in all rings, returns false if there was nothing
+static bool log_drain(void) {
+  static char out[8192];
+  size_t used = 0;
+  bool any = false;
+
+  for (log_ring_t *ring = atomic_load(&rings); ring; ring = ring->next) {
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    size_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+
+    while (tail != head) {
+      log_record_t *rec = (log_record_t *)(ring->data + tail % LOG_RING_SIZE);
+      if (rec->size == LOG_WRAP) {
+        tail += LOG_RING_SIZE - tail % LOG_RING_SIZE;
+        continue;
+      }
+      if (used + LOG_RECORD_MAX > sizeof(out)) {
+        fwrite(out, 1, used, stderr);
+        used = 0;
+      }
+      used += log_unpack(out + used, LOG_RECORD_MAX, rec->fmt, (unsigned char *)(rec + 1));
+      tail += rec->size;
+      any = true;
+    }
+    atomic_store_explicit(&ring->tail, tail, memory_order_release);
+
+    unsigned long dropped = atomic_exchange(&ring->dropped, 0);
+    if (dropped) {
+      fwrite(out, 1, used, stderr);
+      used = snprintf(out, sizeof(out), "WARN:  %lu log messages dropped\n", dropped);
+    }
+  }
+
+  if (used) {
+    fwrite(out, 1, used, stderr);
+    fflush(stderr);
+  }
+  return any;
+}
+
+// whether any ring has records or drops to write
+static bool log_pending(void) {
+  for (log_ring_t *ring = atomic_load(&rings); ring; ring = ring->next) {
+    if (atomic_load(&ring->head) != atomic_load(&ring->tail) || atomic_load(&ring->dropped)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static void log_wake_writer(void) {
+  pthread_mutex_lock(&writer_lock);
+  pthread_cond_signal(&writer_wake);
+  pthread_mutex_unlock(&writer_lock);
+}
+
+static void *log_writer(void *arg) {
+  (void)arg;
+  while (!atomic_load(&writer_stop)) {
+    if (log_drain()) {
+      continue;
+    }
+    // announce the sleep before looking at the rings a last time: a
+    // producer either sees the flag and signals, or its record is seen here
+    pthread_mutex_lock(&writer_lock);
+    atomic_store(&writer_idle, true);
+    atomic_thread_fence(memory_order_seq_cst);
+    if (!log_pending() && !atomic_load(&writer_stop)) {
+      pthread_cond_wait(&writer_wake, &writer_lock);
+    }
+    atomic_store(&writer_idle, false);
+    pthread_mutex_unlock(&writer_lock);
+  }
+  log_drain();
+  return NULL;
+}
+
+void log_flush(void) {
+  if (atomic_load(&writer_running)) {
+    atomic_store(&writer_stop, true);
+    log_wake_writer();
+    pthread_join(writer, NULL);
+    atomic_store(&writer_running, false);
+    atomic_store(&writer_stop, false);
+  }
+}
+
+#ifndef _WIN32
+// the writer thread does not survive fork(); the parent prints whatever
+// was queued, so the child drops its copy and starts a writer on demand
+static void log_atfork_child(void) {
+  pthread_mutex_init(&rings_lock, NULL);
+  pthread_mutex_init(&writer_lock, NULL);
+  pthread_cond_init(&writer_wake, NULL);
+  atomic_store(&writer_idle, false);
+  for (log_ring_t *ring = atomic_load(&rings); ring; ring = ring->next) {
+    atomic_store(&ring->tail, atomic_load(&ring->head));
+  }
+  atomic_store(&writer_running, false);
+  atomic_store(&writer_stop, false);
+}
+#endif
+
+static void log_start_writer(void) {
+  static atomic_bool registered = false;
+
+  pthread_mutex_lock(&rings_lock);
+  if (!atomic_load(&writer_running)) {
+    if (!atomic_exchange(&registered, true)) {
+      atexit(log_flush);
+#ifndef _WIN32
+      pthread_atfork(NULL, NULL, log_atfork_child);
+#endif
+    }
+    if (pthread_create(&writer, NULL, log_writer, NULL) == 0) {
+      atomic_store(&writer_running, true);
+    }
+  }
+  pthread_mutex_unlock(&rings_lock);
+}
+
+static log_ring_t *log_own_ring(void) {
+  if (!own_ring) {
+    own_ring = calloc(1, sizeof(log_ring_t));
+    if (!own_ring) {
+      return NULL;
+    }
+    pthread_mutex_lock(&rings_lock);
+    own_ring->next = atomic_load(&rings);
+    atomic_store(&rings, own_ring);
+    pthread_mutex_unlock(&rings_lock);
+  }
+  return own_ring;
+}
+
+void log_write(enum Verbosity level, const char *fmt, ...) {
+  log_ring_t *ring = log_own_ring();
+  if (!ring) {
+    return;
+  }
+  if (!atomic_load_explicit(&writer_running, memory_order_relaxed)) {
+    log_start_writer();
+  }
+
+  unsigned char buf[LOG_RECORD_MAX];
+  va_list ap;
+  va_start(ap, fmt);
+  size_t size = ALIGN8(sizeof(log_record_t) + log_pack(buf, sizeof(buf) - sizeof(log_record_t), fmt, ap));
+  va_end(ap);
+
+  size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+  size_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+  size_t to_end = LOG_RING_SIZE - head % LOG_RING_SIZE;
+  size_t needed = (to_end < size) ? to_end + size : size;
+
+  if (LOG_RING_SIZE - (head - tail) < needed) {
+    atomic_fetch_add_explicit(&ring->dropped, 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(&writer_idle, memory_order_relaxed)) {
+      log_wake_writer();
+    }
+    return;
+  }
+
+  // records never straddle the end of the ring
+  if (to_end < size) {
+    ((log_record_t *)(ring->data + head % LOG_RING_SIZE))->size = LOG_WRAP;
+    head += to_end;
+  }
+
+  log_record_t *rec = (log_record_t *)(ring->data + head % LOG_RING_SIZE);
+  rec->size = size;
+  rec->level = level;
+  rec->fmt = fmt;
+  memcpy(rec + 1, buf, size - sizeof(log_record_t));
+
+  atomic_store_explicit(&ring->head, head + size, memory_order_release);
+
+  // pairs with the fence of the writer going idle
+  atomic_thread_fence(memory_order_seq_cst);
+  if (atomic_load_explicit(&writer_idle, memory_order_relaxed)) {
+    log_wake_writer();
+  }
+}
@@ -12,23 +12,59 @@ enum Verbosity {
   DEBUG
 };
 
+/**
+ * Most verbose level compiled in. Messages of higher levels are removed by
+ * the compiler entirely, e.g. build with -DLOG_LEVEL=INFO to drop all debug
+ * messages together with their arguments.
+ */
+#ifndef LOG_LEVEL
+  #define LOG_LEVEL DEBUG
+#endif
+
+/**
+ * Current verbosity, tested inline by the logging macros.
+ */
+extern enum Verbosity log_verbosity;
 
 void inc_verbose(void);
 void set_silent(void);
 bool is_verbose_level(enum Verbosity level);
 void print_verbose_level(void);
 
+/**
+ * Queues a message for the background log writer.
+ *
+ * The format string pointer and the raw arguments are copied into a
+ * lock-free ring owned by the calling thread; formatting and the actual
+ * write to stderr happen on the writer thread. `fmt' must be a string
+ * literal, %s arguments are copied (and truncated if very long). When the
+ * ring is full the message is dropped and counted instead of blocking.
+ */
+void log_write(enum Verbosity level, const char *fmt, ...)
+#ifdef __GNUC__
+  __attribute__((format(printf, 2, 3)))
+#endif
+  ;
+
+/**
+ * Writes out all queued messages. Also runs at exit.
+ */
+void log_flush(void);
+
+#define LOG_ENABLED(level) ((level) <= LOG_LEVEL && (level) <= log_verbosity)
+
+// errors stay synchronous, they are rare and often followed by exit()
 #ifdef COLOR_HELP
-  #define __debug__(FMTSTR, ...) if (is_verbose_level(DEBUG)) fprintf(stderr, "\033[2m" "DEBUG: " FMTSTR "\033[0m", ## __VA_ARGS__)
-  #define __info__(FMTSTR, ...)  if (is_verbose_level(INFO))  fprintf(stderr, "INFO:  " FMTSTR, ## __VA_ARGS__)
-  #define __warn__(FMTSTR, ...)  if (is_verbose_level(WARN))  fprintf(stderr, "\033[1;33m" "WARN:  " FMTSTR "\033[0m", ## __VA_ARGS__)
-  #define __error__(FMTSTR, ...) if (is_verbose_level(ERROR)) printf("\033[1;31m" "ERROR: " FMTSTR "\033[0m", ## __VA_ARGS__)
+  #define __debug__(FMTSTR, ...) do { if (LOG_ENABLED(DEBUG)) log_write(DEBUG, "\033[2m" "DEBUG: " FMTSTR "\033[0m", ## __VA_ARGS__); } while (0)
+  #define __info__(FMTSTR, ...)  do { if (LOG_ENABLED(INFO))  log_write(INFO, "INFO:  " FMTSTR, ## __VA_ARGS__); } while (0)
+  #define __warn__(FMTSTR, ...)  do { if (LOG_ENABLED(WARN))  log_write(WARN, "\033[1;33m" "WARN:  " FMTSTR "\033[0m", ## __VA_ARGS__); } while (0)
+  #define __error__(FMTSTR, ...) do { if (LOG_ENABLED(ERROR)) printf("\033[1;31m" "ERROR: " FMTSTR "\033[0m", ## __VA_ARGS__); } while (0)
 #else
-  #define __debug__(FMTSTR, ...) if (is_verbose_level(DEBUG)) fprintf(stderr, "DEBUG: " FMTSTR, ## __VA_ARGS__)
-  #define __info__(FMTSTR, ...)  if (is_verbose_level(INFO))  fprintf(stderr, "INFO:  " FMTSTR, ## __VA_ARGS__)
-  #define __warn__(FMTSTR, ...)  if (is_verbose_level(WARN))  fprintf(stderr, "WARN:  " FMTSTR, ## __VA_ARGS__)
-  #define __error__(FMTSTR, ...) if (is_verbose_level(ERROR)) printf("ERROR: " FMTSTR, ## __VA_ARGS__)
+  #define __debug__(FMTSTR, ...) do { if (LOG_ENABLED(DEBUG)) log_write(DEBUG, "DEBUG: " FMTSTR, ## __VA_ARGS__); } while (0)
+  #define __info__(FMTSTR, ...)  do { if (LOG_ENABLED(INFO))  log_write(INFO, "INFO:  " FMTSTR, ## __VA_ARGS__); } while (0)
+  #define __warn__(FMTSTR, ...)  do { if (LOG_ENABLED(WARN))  log_write(WARN, "WARN:  " FMTSTR, ## __VA_ARGS__); } while (0)
+  #define __error__(FMTSTR, ...) do { if (LOG_ENABLED(ERROR)) printf("ERROR: " FMTSTR, ## __VA_ARGS__); } while (0)
 #endif
-#define __perror__(str) if (is_verbose_level(ERROR)) { __error__(str);perror("ERROR"); }
+#define __perror__(str) do { if (LOG_ENABLED(ERROR)) { __error__(str);perror("ERROR"); } } while (0)
 
 #endif
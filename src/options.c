@@ -4,6 +4,8 @@
 #include "log.h"
 #include "options.h"
 #include "i18n.h"
+#include "bars.h"
+#include "symbols.h"
 
 #ifdef LIBCONFIG
   #include "config.h"
@@ -11,6 +13,68 @@
 
 void print_help(const char* file_name);
 
+int parse_session_start(const char *const src) {
+  int hours, minutes;
+  if (sscanf(src, "%d:%d", &hours, &minutes) != 2 ||
+      hours < 0 || hours > 23 || minutes < 0 || minutes > 59) {
+    return -1;
+  }
+  return hours * 60 + minutes;
+}
+
+int parse_display_mode(const char *const src) {
+  if (strcmp(src, "static") == 0) return DISPLAY_STATIC;
+  if (strcmp(src, "ticker") == 0) return DISPLAY_TICKER;
+  if (strcmp(src, "rotate") == 0) return DISPLAY_ROTATE;
+  return -1;
+}
+
+int parse_board_mode(const char *const src) {
+  if (strcmp(src, "off") == 0) return BOARD_OFF;
+  if (strcmp(src, "publish") == 0) return BOARD_PUBLISH;
+  if (strcmp(src, "attach") == 0) return BOARD_ATTACH;
+  return -1;
+}
+
+int parse_channel_list(const char *const src, char ***channels) {
+  int count = 1;
+  for (const char *p = src; *p; p++) {
+    if (*p == ',') count++;
+  }
+  if (count > SYMBOLS_MAX) {
+    return -1;
+  }
+
+  char **list = malloc(count * sizeof(char *));
+  char *copy = strdup(src);
+  if (!list || !copy) {
+    free(list);
+    free(copy);
+    return -1;
+  }
+
+  int n = 0;
+  for (char *name = strtok(copy, ","); name; name = strtok(NULL, ",")) {
+    if (strlen(name) >= SYMBOL_NAME_LEN) {
+      free(list);
+      free(copy);
+      return -1;
+    }
+    list[n++] = name;
+  }
+  if (n == 0) {
+    free(list);
+    free(copy);
+    return -1;
+  }
+
+  // the names stay in `copy', which lives as long as the list
+  *channels = list;
+  return n;
+}
+
+static char *default_channels[] = {"SP500", "ES1"};
+
 Options options = {
   // title and subtitle takes from default preset
   // determined on compilation stage
@@ -31,6 +95,24 @@ Options options = {
   // on both light and dark background.
   .text_color = {.r=0.7686275, .g=0.7686275, .b=0.7686275, .a=0.4},
 
+  // hours of history in the price sparkline, 0 disables it
+  .sparkline_hours = 0.0f,
+
+  // two-line overlay of the most recent quote
+  .display_mode = DISPLAY_STATIC,
+  .ticker_speed = 60.0f,
+  .rotate_interval = 5.0f,
+  .frame_cache_kb = 4096,
+  .flash_seconds = 0.0f,
+  .animation_fps = 30,
+  .animation_budget = 5.0f,
+
+  // change and color come from the publisher unless a bar period is chosen
+  .bar_period = -1,
+  .analytics = false,
+  .zscore_color = false,
+  .session_start = 0,
+
   // bypass compositor hint
   .bypass_compositor = false,
 
@@ -42,114 +124,314 @@ Options options = {
 
   // kill running instance of activate-linux
   .kill_running = false,
+  .control_command = NULL,
+  .startup_trace = false,
 #ifdef X11
       .force_xshape = false,
+      .monitors = NULL,
 #endif
 
   // hostname for Redis
   .host = NULL,
+  .port = 6379,
+  .redis_socket = NULL,
+  .keepalive = 15,
+  .receive_buffer_kb = 0,
+  .cluster = false,
+  .channels = default_channels,
+  .channel_count = sizeof(default_channels) / sizeof(default_channels[0]),
+  .board_mode = BOARD_OFF,
 };
 
 
-void parse_options(int argc, char *const argv[]) {
-  __debug__("Start option parsing\n");
+// the command line, permuted by getopt_long(), for options_reapply()
+static int saved_argc = 0;
+static char *const *saved_argv = NULL;
+// the list of -Y, parsed once
+static char **cli_channels = NULL;
+static int cli_channel_count = 0;
 
-  int option_index = 0;
-  const struct option long_options[] = {
-    // text
-    {"text-title",          required_argument, NULL, 't'},
-    {"text-message",        required_argument, NULL, 'm'},
-    {"text-preset",         required_argument, NULL, 'p'},
-    // appearance
-    {"text-font",           required_argument, NULL, 'f'},
-    {"text-bold",           no_argument,       NULL, 'b'},
-    {"text-italic",         no_argument,       NULL, 'i'},
-    {"text-color",          required_argument, NULL, 'c'},
-    // size and position
-    {"overlay-width",       required_argument, NULL, 'x'},
-    {"overlay-height",      required_argument, NULL, 'y'},
-    {"scale",               required_argument, NULL, 's'},
-    // other
-    {"bypass-compositor",   no_argument,       NULL, 'w'},
-    {"daemonize",           no_argument,       NULL, 'd'},
-    {"kill-running",        no_argument,       NULL, 'K'},
-    {"verbose",             no_argument,       NULL, 'v'},
-    {"text-preset-list",    no_argument,       NULL, 'l'},
-    {"quiet",               no_argument,       NULL, 'q'},
-    {"gamescope",           no_argument,       NULL, 'G'},
+static const char short_options[] = "t:m:p:f:bic:x:y:s:g:B:aZT:D:V:r:F:e:N:W:wdKk:PvlqGH:o:U:A:R:zY:Q:h"
 #ifdef X11
-    {"force-xshape",           no_argument,       NULL, 'S'},
+  "SM:"
 #endif
-    {"host",                required_argument, NULL, 'H'},
 #ifdef LIBCONFIG
-    {"config-file",         required_argument, NULL, 'C'},
+  "C:"
 #endif
-    {"help",                no_argument,       NULL, 'h'},
-    {NULL, 0, NULL, 0},
-  };
+  ;
 
-  int opt;
-  while ((opt = getopt_long(argc, argv, "t:m:p:f:bic:x:y:s:wdKvlqGH:h"
+static const struct option long_options[] = {
+  // text
+  {"text-title",          required_argument, NULL, 't'},
+  {"text-message",        required_argument, NULL, 'm'},
+  {"text-preset",         required_argument, NULL, 'p'},
+  // appearance
+  {"text-font",           required_argument, NULL, 'f'},
+  {"text-bold",           no_argument,       NULL, 'b'},
+  {"text-italic",         no_argument,       NULL, 'i'},
+  {"text-color",          required_argument, NULL, 'c'},
+  // size and position
+  {"overlay-width",       required_argument, NULL, 'x'},
+  {"overlay-height",      required_argument, NULL, 'y'},
+  {"scale",               required_argument, NULL, 's'},
+  {"sparkline",           required_argument, NULL, 'g'},
+  {"bars",                required_argument, NULL, 'B'},
+  {"analytics",           no_argument,       NULL, 'a'},
+  {"zscore-color",        no_argument,       NULL, 'Z'},
+  {"display",             required_argument, NULL, 'D'},
+  {"ticker-speed",        required_argument, NULL, 'V'},
+  {"rotate-interval",     required_argument, NULL, 'r'},
+  {"frame-cache",         required_argument, NULL, 'F'},
+  {"flash",               required_argument, NULL, 'e'},
+  {"animation-fps",       required_argument, NULL, 'N'},
+  {"animation-budget",    required_argument, NULL, 'W'},
+  {"session-start",       required_argument, NULL, 'T'},
+  // other
+  {"bypass-compositor",   no_argument,       NULL, 'w'},
+  {"daemonize",           no_argument,       NULL, 'd'},
+  {"kill-running",        no_argument,       NULL, 'K'},
+  {"control",             required_argument, NULL, 'k'},
+  {"startup-trace",       no_argument,       NULL, 'P'},
+  {"verbose",             no_argument,       NULL, 'v'},
+  {"text-preset-list",    no_argument,       NULL, 'l'},
+  {"quiet",               no_argument,       NULL, 'q'},
+  {"gamescope",           no_argument,       NULL, 'G'},
 #ifdef X11
-      "S"
+  {"force-xshape",           no_argument,       NULL, 'S'},
+  {"monitors",            required_argument, NULL, 'M'},
 #endif
+  {"host",                required_argument, NULL, 'H'},
+  {"port",                required_argument, NULL, 'o'},
+  {"redis-socket",        required_argument, NULL, 'U'},
+  {"keepalive",           required_argument, NULL, 'A'},
+  {"receive-buffer",      required_argument, NULL, 'R'},
+  {"cluster",             no_argument,       NULL, 'z'},
+  {"symbols",             required_argument, NULL, 'Y'},
+  {"quote-board",         required_argument, NULL, 'Q'},
 #ifdef LIBCONFIG
-      "C:"
+  {"config-file",         required_argument, NULL, 'C'},
 #endif
-      , long_options, &option_index)) != -1) {
-    __debug__("Got option \"%c\" (%c) with argument \"%s\"\n", opt, optopt, optarg);
-    switch (opt) {
-      // text
-      case 't': options.title = optarg; break;
-      case 'm': options.subtitle = optarg; break;
-      case 'p': i18n_set_info(optarg); break;
-      // appearance
-      case 'f': options.custom_font = optarg; break;
-      case 'b': options.bold_mode = true; break;
-      case 'i': options.italic_mode = true; break;
-      // size and position
-      case 'x': options.overlay_width = atoi(optarg); break;
-      case 'y': options.overlay_height = atoi(optarg); break;
-      // other
-      case 'w': options.bypass_compositor = true; break;
-      case 'd': options.daemonize = true; break;
-      case 'K': options.kill_running = true; break;
-      case 'v': inc_verbose(); break;
-      case 'q': set_silent(); break;
-      case 'G': options.gamescope_overlay = true; break;
-      // Redis
-      case 'H': options.host = optarg; break;
+  {"help",                no_argument,       NULL, 'h'},
+  {NULL, 0, NULL, 0},
+};
+
+// Applies one option to the global options
+static void apply_option(int opt, const char *const program) {
+  switch (opt) {
+    // text
+    case 't': options.title = optarg; break;
+    case 'm': options.subtitle = optarg; break;
+    case 'p': i18n_set_info(optarg); break;
+    // appearance
+    case 'f': options.custom_font = optarg; break;
+    case 'b': options.bold_mode = true; break;
+    case 'i': options.italic_mode = true; break;
+    // size and position
+    case 'x': options.overlay_width = atoi(optarg); break;
+    case 'y': options.overlay_height = atoi(optarg); break;
+    case 'a': options.analytics = true; break;
+    case 'Z': options.zscore_color = true; break;
+    // other
+    case 'w': options.bypass_compositor = true; break;
+    case 'd': options.daemonize = true; break;
+    case 'K': options.kill_running = true; break;
+    case 'k': options.control_command = optarg; break;
+    case 'P': options.startup_trace = true; break;
+    case 'v': inc_verbose(); break;
+    case 'q': set_silent(); break;
+    case 'G': options.gamescope_overlay = true; break;
+    // Redis
+    case 'H': options.host = optarg; break;
+    case 'U': options.redis_socket = optarg; break;
+    case 'z': options.cluster = true; break;
+    case 'o':
+      options.port = atoi(optarg);
+      if (options.port <= 0 || options.port > 65535) {
+        __error__("Cannot parse port. It must be a number between 1 and 65535.\n");
+        exit(EXIT_FAILURE);
+      }
+      break;
+    case 'A':
+      options.keepalive = atoi(optarg);
+      if (options.keepalive < 0) {
+        __error__("Cannot parse keepalive. It must be a number of seconds, 0 disables it.\n");
+        exit(EXIT_FAILURE);
+      }
+      break;
+    case 'R':
+      options.receive_buffer_kb = atoi(optarg);
+      if (options.receive_buffer_kb < 0) {
+        __error__("Cannot parse receive buffer size. It must be a number of kilobytes, 0 keeps the default.\n");
+        exit(EXIT_FAILURE);
+      }
+      break;
+    case 'Y':
+      // parsed once, a replay reuses the list
+      if (!cli_channels) {
+        cli_channel_count = parse_channel_list(optarg, &cli_channels);
+        if (cli_channel_count < 0) {
+          __error__("Cannot parse symbols. Use a comma separated list of names of up to %d characters.\n",
+                    SYMBOL_NAME_LEN - 1);
+          exit(EXIT_FAILURE);
+        }
+      }
+      options.channels = cli_channels;
+      options.channel_count = cli_channel_count;
+      break;
 #ifdef LIBCONFIG
-      case 'C': load_config(optarg); break;
+    case 'C': load_config(optarg); break;
 #endif
 #ifdef X11
-      case 'S': options.force_xshape = true; break;
+    case 'S': options.force_xshape = true; break;
+    case 'M': options.monitors = optarg; break;
 #endif
-      case 's':
-        options.scale = atof(optarg);
-        if (options.scale < 0.0f) {
-          __error__("Cannot parse custom scale value. It must be number greater than 0.0.\n");
-          exit(EXIT_FAILURE);
-        }
-        break;
-      case 'c':
-        options.text_color = rgba_color_string(optarg);
-        if (options.text_color.a < 0.0f) {
-          __error__("Cannot parse custom color value. Please, use option -h to check proper format\n");
-          exit(EXIT_FAILURE);
-        }
-        break;
-      case 'l':
-        i18n_list_presets();
-        exit(EXIT_SUCCESS);
-      case '?':
-      case 'h':
-        print_help(argv[0]);
-        exit(EXIT_SUCCESS);
+    case 's':
+      options.scale = atof(optarg);
+      if (options.scale < 0.0f) {
+        __error__("Cannot parse custom scale value. It must be number greater than 0.0.\n");
+        exit(EXIT_FAILURE);
+      }
+      break;
+    case 'g':
+      options.sparkline_hours = atof(optarg);
+      if (options.sparkline_hours < 0.0f) {
+        __error__("Cannot parse sparkline hours. It must be number greater than or equal to 0.0.\n");
+        exit(EXIT_FAILURE);
+      }
+      break;
+    case 'B':
+      options.bar_period = bars_parse_period(optarg);
+      if (options.bar_period < 0) {
+        __error__("Unknown bar period \"%s\". Use 1m, 5m or session.\n", optarg);
+        exit(EXIT_FAILURE);
+      }
+      break;
+    case 'T':
+      options.session_start = parse_session_start(optarg);
+      if (options.session_start < 0) {
+        __error__("Cannot parse session start time. It must be in HH:MM format.\n");
+        exit(EXIT_FAILURE);
+      }
+      break;
+    case 'Q': {
+      int mode = parse_board_mode(optarg);
+      if (mode < 0) {
+        __error__("Unknown quote board mode \"%s\". Use off, publish or attach.\n", optarg);
+        exit(EXIT_FAILURE);
+      }
+      options.board_mode = mode;
+      break;
     }
+    case 'D': {
+      int mode = parse_display_mode(optarg);
+      if (mode < 0) {
+        __error__("Unknown display mode \"%s\". Use static, ticker or rotate.\n", optarg);
+        exit(EXIT_FAILURE);
+      }
+      options.display_mode = mode;
+      break;
+    }
+    case 'V':
+      options.ticker_speed = atof(optarg);
+      if (options.ticker_speed < 0.0f) {
+        __error__("Cannot parse ticker speed. It must be number greater than or equal to 0.0.\n");
+        exit(EXIT_FAILURE);
+      }
+      break;
+    case 'r':
+      options.rotate_interval = atof(optarg);
+      if (options.rotate_interval <= 0.0f) {
+        __error__("Cannot parse rotation interval. It must be number greater than 0.0.\n");
+        exit(EXIT_FAILURE);
+      }
+      break;
+    case 'F':
+      options.frame_cache_kb = atoi(optarg);
+      if (options.frame_cache_kb < 0) {
+        __error__("Cannot parse frame cache size. It must be a non-negative integer.\n");
+        exit(EXIT_FAILURE);
+      }
+      break;
+    case 'e':
+      options.flash_seconds = atof(optarg);
+      if (options.flash_seconds < 0.0f) {
+        __error__("Cannot parse flash duration. It must be number greater than or equal to 0.0.\n");
+        exit(EXIT_FAILURE);
+      }
+      break;
+    case 'N':
+      options.animation_fps = atoi(optarg);
+      if (options.animation_fps <= 0) {
+        __error__("Cannot parse animation frame rate. It must be a positive integer.\n");
+        exit(EXIT_FAILURE);
+      }
+      break;
+    case 'W':
+      options.animation_budget = atof(optarg);
+      if (options.animation_budget <= 0.0f || options.animation_budget > 100.0f) {
+        __error__("Cannot parse animation CPU budget. It must be a percentage greater than 0.0.\n");
+        exit(EXIT_FAILURE);
+      }
+      break;
+    case 'c':
+      options.text_color = rgba_color_string(optarg);
+      if (options.text_color.a < 0.0f) {
+        __error__("Cannot parse custom color value. Please, use option -h to check proper format\n");
+        exit(EXIT_FAILURE);
+      }
+      break;
+    case 'l':
+      i18n_list_presets();
+      exit(EXIT_SUCCESS);
+    case '?':
+    case 'h':
+      print_help(program);
+      exit(EXIT_SUCCESS);
   }
 }
 
+void parse_options(int argc, char *const argv[]) {
+  __debug__("Start option parsing\n");
+
+  int option_index = 0;
+  int opt;
+  while ((opt = getopt_long(argc, argv, short_options, long_options, &option_index)) != -1) {
+    __debug__("Got option \"%c\" (%c) with argument \"%s\"\n", opt, optopt, optarg);
+    apply_option(opt, argv[0]);
+  }
+  saved_argc = argc;
+  saved_argv = argv;
+}
+
+void options_reapply(Options *o) {
+  if (!saved_argv) {
+    return;
+  }
+  Options running = options;
+  options = *o;
+
+  int saved_opterr = opterr;
+  opterr = 0;
+  optind = 0;           // restarts GNU getopt, including its internal state
+  bool after_config = false;
+  int option_index = 0;
+  int opt;
+  while ((opt = getopt_long(saved_argc, saved_argv, short_options, long_options, &option_index)) != -1) {
+    // only plain settings: what has side effects happened at startup, and
+    // the color is display state that reloads keep anyway (its argument
+    // was cut up by strtok())
+    if (opt == 'C') {
+      after_config = true;
+    } else if (after_config && !strchr("pvqlhc?", opt)) {
+      apply_option(opt, saved_argv[0]);
+    }
+  }
+  opterr = saved_opterr;
+
+  *o = options;
+  options = running;
+}
+
 void print_help(const char *const file_name) {
 #define HELP(fmtstr, ...) fprintf(stderr, "  " fmtstr "\n", ##__VA_ARGS__)
 #define SECTION(name, fmtstr, ...) \
@@ -196,26 +478,59 @@ void print_help(const char *const file_name) {
   HELP("-x, --overlay-width width \tSet overlay width  before scaling (integer)");
   HELP("-y, --overlay-height height \tSet overlay height before scaling (integer)");
   HELP("-s, --scale scale \t\tScale ratio (float)");
+  HELP("-g, --sparkline hours \t\tShow a price sparkline of the last hours (float, 0 disables)");
+  HELP("-B, --bars period \t\tShow and color by the change of the current 1m, 5m or session bar");
+  HELP("-a, --analytics \t\tShow session VWAP, volatility of 1m returns and z-score of the");
+  HELP("\t\t\t\t current minute's move below the quote");
+  HELP("-Z, --zscore-color \t\tColor by the z-score of the current minute's move");
+  HELP("-T, --session-start HH:MM \tLocal time at which session bars start (default 00:00)");
+  HELP("-D, --display mode \t\tstatic (most recent quote), ticker (scrolling tape of all symbols)");
+  HELP("\t\t\t\t or rotate (cycle through all symbols)");
+  HELP("-V, --ticker-speed speed \tTicker tape speed in pixels per second before scaling (float)");
+  HELP("-r, --rotate-interval secs \tSeconds each symbol is shown in rotate mode (float)");
+  HELP("-F, --frame-cache kilobytes \tMemory bound of the rotate mode frame cache (integer)");
+  HELP("-e, --flash secs \t\tFlash green or red on ticks and fade into the quote color");
+  HELP("\t\t\t\t over secs in the static display (float, default 0 disables)");
+  HELP("-N, --animation-fps fps \tFrame rate cap of the flashes (default 30)");
+  HELP("-W, --animation-budget percent \tCPU time the flash frames may take before their frame");
+  HELP("\t\t\t\t rate is lowered (default 5)");
   END();
 
   SECTION("Other", "");
   HELP("-w, --bypass-compositor \tSet EWMH bypass_compositor hint");
   HELP("-d, --daemonize \t\tFork to background on startup");
   HELP("-K, --kill-running \t\tKill running activate-linux instance");
+  HELP("-k, --control request \t\tSend quit, status, stats, \"subscribe SYM...\" or");
+  HELP("\t\t\t\t \"unsubscribe SYM...\" to the running instance");
+  HELP("-P, --startup-trace \t\tPrint how long each startup phase took");
   HELP("-l, --text-preset-list \tList predefined presets");
   HELP("-v, --verbose \t\tIncrease console spam level");
   HELP("-q, --quiet \t\t\tBecome completely silent");
   HELP("-G, --gamescope \t\tRun as an external gamescope overlay (EXPERIMENTAL)");
 #ifdef X11
   HELP("-S, --force-xshape \t\tUse the X11 shaping extention for rendering fake transparency.");
+  HELP("-M, --monitors list \t\tprimary (default), all, or comma separated monitor names as");
+  HELP("\t\t\t\t listed by xrandr --listmonitors, to show an overlay on");
 #endif
 #ifdef LIBCONFIG
-  HELP("-C, --config-file \t\tLoad options from an external configuration file");
+  HELP("-C, --config-file \t\tLoad options from an external configuration file,");
+  HELP("\t\t\t\t which is reloaded whenever it changes");
 #endif
   END();
 
   SECTION("Redis", "");
-  HELP("-H, --host hostname \t\tSet Redis server hostname");
+  HELP("-H, --host hostname \t\tSet Redis server hostname, or comma separated host[:port]");
+  HELP("\t\t\t\t servers that all publish the quotes, the first copy wins");
+  HELP("-o, --port port \t\tSet Redis server port (default 6379)");
+  HELP("-U, --redis-socket path \tConnect through a Unix domain socket instead of TCP");
+  HELP("-A, --keepalive secs \t\tIdle seconds before TCP keepalive probes (default 15, 0 disables)");
+  HELP("-R, --receive-buffer kilobytes \tSize of the socket receive buffer (default from the system)");
+  HELP("-z, --cluster \t\t\tThe host is a Redis Cluster node, subscribe to each symbol");
+  HELP("\t\t\t\t on the shard owning it with SSUBSCRIBE");
+  HELP("-Y, --symbols list \t\tComma separated symbols to subscribe to (default SP500,ES1),");
+  HELP("\t\t\t\t names with *, ? or [ are subscribed to as patterns");
+  HELP("-Q, --quote-board mode \tpublish quotes for other instances in shared memory, or");
+  HELP("\t\t\t\t attach to them instead of connecting to Redis (default off)");
 
   END();
 #undef HELP
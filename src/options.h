@@ -5,6 +5,18 @@
 #include <string.h>
 #include "color.h"
 
+typedef enum {
+  DISPLAY_STATIC,
+  DISPLAY_TICKER,
+  DISPLAY_ROTATE,
+} display_mode_t;
+
+typedef enum {
+  BOARD_OFF,
+  BOARD_PUBLISH,
+  BOARD_ATTACH,
+} board_mode_t;
+
 typedef struct options_t {
   char *title;
   char *subtitle;
@@ -20,19 +32,77 @@ typedef struct options_t {
 
   rgba_color text_color;
 
+  float sparkline_hours;
+
+  display_mode_t display_mode;
+  // ticker tape speed before scaling, in pixels per second
+  float ticker_speed;
+  // seconds each symbol is shown in rotation mode
+  float rotate_interval;
+  // memory bound of the rotation mode frame cache, in kilobytes
+  int frame_cache_kb;
+  // seconds a tick flashes before fading into the quote color, 0 disables it
+  float flash_seconds;
+  // frame rate cap of animations, and the percentage of the time their
+  // frames may take before the rate is lowered
+  int animation_fps;
+  float animation_budget;
+
+  // bar period driving the displayed change and color, -1 uses the feed's own
+  int bar_period;
+  // show session VWAP, volatility and z-score of the move below the quote
+  bool analytics;
+  // color by the z-score of the move instead of the percent change
+  bool zscore_color;
+  // minutes after local midnight at which a trading session starts
+  int session_start;
+
   bool bypass_compositor;
   bool gamescope_overlay;
   bool daemonize;
   bool kill_running;
+  // request for the control socket of the running instance
+  char *control_command;
+  // print how long each startup phase took
+  bool startup_trace;
 #ifdef X11
   bool force_xshape;
+  // monitors with an overlay: "primary", "all" or a list of monitor names
+  char *monitors;
 #endif
   /* Redis */
   char *host;
+  int port;
+  // Unix domain socket of the server, used instead of host and port
+  char *redis_socket;
+  // idle seconds before TCP keepalive probes, 0 disables them
+  int keepalive;
+  // socket receive buffer in kilobytes, 0 keeps the system default
+  int receive_buffer_kb;
+  // host and port are a node of a Redis Cluster, use sharded pub/sub
+  bool cluster;
+  // channels to subscribe to, one per symbol
+  char **channels;
+  int channel_count;
+  // sharing one subscription with other instances through shared memory
+  board_mode_t board_mode;
 } Options;
 
 extern Options options;
 
 void parse_options(int argc, char *const argv[]);
 
+/**
+ * Applies again the command line options that followed the config file,
+ * so that they keep overriding it when it is reloaded. Options that act
+ * at startup only, like -v or -p, are left out.
+ *
+ * @param o The options to apply them to instead of the global ones.
+ */
+void options_reapply(Options *o);
+int parse_session_start(const char *const src);
+int parse_display_mode(const char *const src);
+int parse_board_mode(const char *const src);
+int parse_channel_list(const char *const src, char ***channels);
+
 #endif
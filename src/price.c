@@ -0,0 +1,138 @@
+#include "price.h"
+#include <stdlib.h>
+
+static const int64_t pow10_int[PRICE_SCALE_MAX + 1] = {
+  1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000
+};
+
+static const double pow10_double[PRICE_SCALE_MAX + 1] = {
+  1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8
+};
+
+// integer parts from here on are out of range: with PRICE_SCALE_MAX
+// decimals the mantissa would not fit
+#define PRICE_INTEGER_LIMIT 90000000000LL
+
+int price_parse(const char *src, const char **end, price_t *out) {
+  const char *p = src;
+  while (*p == ' ' || *p == '\t') p++;
+
+  bool negative = *p == '-';
+  if (*p == '-' || *p == '+') p++;
+
+  int64_t mantissa = 0;
+  int scale = -1;
+  int digits = 0;
+  for (;; p++) {
+    if (*p >= '0' && *p <= '9') {
+      digits++;
+      if (scale >= PRICE_SCALE_MAX) {
+        continue;
+      }
+      if (mantissa > (INT64_MAX - 9) / 10) {
+        break;
+      }
+      mantissa = mantissa * 10 + (*p - '0');
+      if (scale >= 0) {
+        scale++;
+      } else if (mantissa >= PRICE_INTEGER_LIMIT) {
+        return -1;
+      }
+    } else if (*p == '.' && scale < 0) {
+      scale = 0;
+    } else {
+      break;
+    }
+  }
+
+  // anything unusual right after the digits, e.g. "1e-05" or "nan"
+  if (digits == 0 || (*p != '\0' && *p != ';' && *p != ' ' && *p != '\t' && *p != '\n' && *p != '\r')) {
+    char *e;
+    double value = strtod(src, &e);
+    if (e == src) {
+      return -1;
+    }
+    // out of the range of the mantissa, which includes NaN
+    if (!(value > -PRICE_INTEGER_LIMIT && value < PRICE_INTEGER_LIMIT)) {
+      return -1;
+    }
+    *out = price_from_double(value, PRICE_SCALE_MAX);
+    if (end) *end = e;
+    return 0;
+  }
+
+  out->mantissa = negative ? -mantissa : mantissa;
+  out->scale = scale < 0 ? 0 : scale;
+  if (end) *end = p;
+  return 0;
+}
+
+price_t price_rescale(price_t p, int scale) {
+  if (scale > p.scale) {
+    int64_t mul = pow10_int[scale - p.scale];
+    if (p.mantissa > INT64_MAX / mul) {
+      p.mantissa = INT64_MAX;
+    } else if (p.mantissa < INT64_MIN / mul) {
+      p.mantissa = INT64_MIN;
+    } else {
+      p.mantissa *= mul;
+    }
+  } else if (scale < p.scale) {
+    int64_t div = pow10_int[p.scale - scale];
+    int64_t half = div / 2;
+    p.mantissa = (p.mantissa < 0 ? p.mantissa - half : p.mantissa + half) / div;
+  }
+  p.scale = scale;
+  return p;
+}
+
+price_t price_from_double(double value, int scale) {
+  double scaled = value * pow10_double[scale];
+  // rounds half away from zero without libm
+  price_t p = { (int64_t)(scaled < 0 ? scaled - 0.5 : scaled + 0.5), scale };
+  return p;
+}
+
+double price_to_double(price_t p) {
+  return p.mantissa / pow10_double[p.scale];
+}
+
+char *price_format(char *dst, const char *end, price_t p, int decimals, bool plus) {
+  // as with printf, a negative value rounding to zero keeps its sign
+  bool negative = p.mantissa < 0;
+  p = price_rescale(p, decimals);
+
+  if (negative) {
+    if (dst < end) *dst++ = '-';
+  } else if (plus) {
+    if (dst < end) *dst++ = '+';
+  }
+
+  uint64_t value = p.mantissa < 0 ? -(uint64_t)p.mantissa : (uint64_t)p.mantissa;
+  uint64_t integer = value / pow10_int[decimals];
+  uint64_t fraction = value % pow10_int[decimals];
+
+  // digits come out last first
+  char buf[24];
+  int n = 0;
+  do {
+    buf[n++] = '0' + integer % 10;
+    integer /= 10;
+  } while (integer > 0);
+  while (n > 0 && dst < end) {
+    *dst++ = buf[--n];
+  }
+
+  if (decimals > 0) {
+    if (dst < end) *dst++ = '.';
+    for (int i = decimals - 1; i >= 0; i--) {
+      buf[i] = '0' + fraction % 10;
+      fraction /= 10;
+    }
+    for (int i = 0; i < decimals && dst < end; i++) {
+      *dst++ = buf[i];
+    }
+  }
+
+  return dst;
+}
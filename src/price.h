@@ -0,0 +1,77 @@
+#ifndef INCLUDE_PRICE_H
+#define INCLUDE_PRICE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * Most decimals kept by a price, further digits are dropped.
+ */
+#define PRICE_SCALE_MAX 8
+
+/**
+ * Struct representing a decimal price in fixed point.
+ *
+ * The value is `mantissa' / 10^`scale', so "5012.25" is {501225, 2} and
+ * keeps exactly the digits that were published.
+ */
+typedef struct price_t {
+  int64_t mantissa;
+  int scale;
+} price_t;
+
+/**
+ * Parses a decimal number such as "-12.50" straight from its digits.
+ *
+ * Numbers in other notations, e.g. with an exponent, are accepted through
+ * strtod() and kept with PRICE_SCALE_MAX decimals.
+ *
+ * @param src The text; leading blanks are skipped.
+ * @param end Receives the first character after the number, may be NULL.
+ * @param out Receives the price.
+ *
+ * @returns 0 on success, -1 if `src' does not start with a number or the
+ *          number is out of range (an integer part of 9e10 or more, or
+ *          NaN).
+ */
+int price_parse(const char *src, const char **end, price_t *out);
+
+/**
+ * @returns The price with exactly `scale' decimals, rounded half away from
+ *          zero if decimals are dropped. A mantissa that would overflow
+ *          saturates at INT64_MAX or INT64_MIN, which parsed prices never
+ *          reach.
+ */
+price_t price_rescale(price_t p, int scale);
+
+/**
+ * @returns The price of a double value, with `scale' decimals.
+ */
+price_t price_from_double(double value, int scale);
+
+/**
+ * @returns The price as a double, e.g. for drawing and color choices.
+ */
+double price_to_double(price_t p);
+
+/**
+ * Formats a price without going through printf.
+ *
+ * Writes the text of "%.*f", or "%+.*f" if `plus' is set, for the decimal
+ * value of `p': dropped decimals round half away from zero, so a tie such
+ * as 0.125 gives "0.13" where printf rounds the nearest double and may give
+ * "0.12". A negative value rounding to zero keeps its minus sign, "-0.00",
+ * as with printf. No terminating zero is written, and the output is cut at
+ * `end'.
+ *
+ * @param dst      Where to write.
+ * @param end      End of the space available at `dst'.
+ * @param p        The price.
+ * @param decimals Decimals to show, at most PRICE_SCALE_MAX.
+ * @param plus     Whether positive values get a '+'.
+ *
+ * @returns The position after the last character written.
+ */
+char *price_format(char *dst, const char *end, price_t p, int decimals, bool plus);
+
+#endif
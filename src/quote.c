@@ -0,0 +1,129 @@
+#include <stdlib.h>
+#include <string.h>
+#define __USE_XOPEN     // for strptime
+#include <time.h>
+
+#include "quote.h"
+
+// Function to parse semicolon-separated stock data string
+int parse_stock_data(const char* data_str, stock_data_t* stock_data) {
+    if (!data_str || !stock_data) {
+        return -1;
+    }
+
+    price_t *prices[8] = {
+        NULL,                           // formatted time
+        &stock_data->open,
+        &stock_data->high,
+        &stock_data->low,
+        &stock_data->close,
+        NULL,                           // volume
+        &stock_data->change,
+        &stock_data->percent_change,
+    };
+
+    // Parse each field separated by semicolon, in place, see the repo
+    // https://github.com/eddelbuettel/redis-pubsub-example
+    // for a sample producer (and a simpler consumer)
+    const char *field = data_str;
+    int field_count = 0;
+    while (field_count < 8) {
+        const char *end = strchr(field, ';');
+        if (!end) {
+            end = field + strlen(field);
+        }
+
+        if (field_count == 0) {
+            size_t len = end - field;
+            if (len >= sizeof(stock_data->fmttime)) {
+                len = sizeof(stock_data->fmttime) - 1;
+            }
+            memcpy(stock_data->fmttime, field, len);
+            stock_data->fmttime[len] = '\0';
+        } else if (field_count == 5) {
+            stock_data->volume = strtol(field, NULL, 10);
+        } else if (price_parse(field, NULL, prices[field_count]) != 0) {
+            break;
+        }
+        field_count++;
+
+        if (*end == '\0') {
+            break;
+        }
+        field = end + 1;
+    }
+
+    stock_data->time = quote_time(stock_data->fmttime);
+
+    return (field_count == 8) ? 0 : -1;
+}
+
+double quote_time(const char *fmttime) {
+    struct tm tm = {0};
+    tm.tm_isdst = -1;           // let mktime() find out
+    strptime(fmttime, "%Y-%m-%d %H:%M:%S", &tm);
+    return mktime(&tm);
+}
+
+// Copies a string, cut at `end'
+static char *append(char *dst, const char *end, const char *src) {
+    while (*src && dst < end) {
+        *dst++ = *src++;
+    }
+    return dst;
+}
+
+// Function to format stock data and time into its title and subtitle,
+// without printf
+void format_quote(stock_data_t *data, price_t change, price_t percent_change, int decimals) {
+    char *p = data->title;
+    const char *end = data->title + sizeof(data->title) - 1;
+    p = price_format(p, end, data->close, decimals, false);
+    p = append(p, end, " ");
+    p = price_format(p, end, change, decimals, true);
+    p = append(p, end, " ");
+    p = price_format(p, end, percent_change, 3, true);
+    p = append(p, end, "%");
+    *p = '\0';
+
+    p = data->subtitle;
+    end = data->subtitle + sizeof(data->subtitle) - 1;
+    p = append(p, end, data->symbol);
+    p = append(p, end, " @ ");
+    p = append(p, end, data->fmttime);
+    *p = '\0';
+}
+
+void format_quote_analytics(stock_data_t *data, const analytics_t *stats, int decimals) {
+    char *p = data->subtitle + strlen(data->subtitle);
+    const char *end = data->subtitle + sizeof(data->subtitle) - 1;
+    const char *separator = "\n";
+    if (stats->vwap > 0) {
+        p = append(p, end, "\nVWAP ");
+        p = price_format(p, end, price_from_double(stats->vwap, decimals), decimals, false);
+        separator = "  ";
+    }
+    if (stats->minutes > 1) {
+        p = append(p, end, separator);
+        p = append(p, end, "vol ");
+        p = price_format(p, end, price_from_double(stats->volatility, 3), 3, false);
+        p = append(p, end, "%  z ");
+        p = price_format(p, end, price_from_double(stats->zscore, 1), 1, true);
+    }
+    *p = '\0';
+}
+
+void format_quote_ticker(char *dst, size_t size, const stock_data_t *data,
+                         price_t change, price_t percent_change, int decimals) {
+    char *p = dst;
+    const char *end = dst + size - 1;
+    p = append(p, end, data->symbol);
+    p = append(p, end, " ");
+    p = price_format(p, end, data->close, decimals, false);
+    p = append(p, end, " ");
+    p = price_format(p, end, change, decimals, true);
+    p = append(p, end, " ");
+    p = price_format(p, end, percent_change, 2, true);
+    p = append(p, end, "%");
+    *p = '\0';
+}
@@ -0,0 +1,83 @@
+#ifndef INCLUDE_QUOTE_H
+#define INCLUDE_QUOTE_H
+
+#include <stddef.h>
+#include "analytics.h"
+#include "price.h"
+
+// Structure to hold parsed stock data
+typedef struct {
+    char fmttime[32];
+    double time;
+    price_t open;
+    price_t high;
+    price_t low;
+    price_t close;
+    long volume;
+    price_t percent_change;
+    price_t change;
+    char symbol[16];
+    int updated;
+    char title[64];
+    char subtitle[64];
+} stock_data_t;
+
+/**
+ * Parses a semicolon-separated quote record as published by
+ * https://github.com/eddelbuettel/redis-pubsub-example
+ *
+ * Prices are decoded straight from their digits into fixed point.
+ *
+ * @param data_str   The message payload.
+ * @param stock_data The record to fill; `symbol' must already be set.
+ *
+ * @returns 0 if all eight fields were found and parsed, -1 otherwise, e.g.
+ *          for a price out of range.
+ */
+int parse_stock_data(const char *data_str, stock_data_t *stock_data);
+
+/**
+ * Converts the local time of a quote record, "YYYY-mm-dd HH:MM:SS", as
+ * parse_stock_data() does.
+ *
+ * @param fmttime The time as published.
+ *
+ * @returns Seconds since the epoch.
+ */
+double quote_time(const char *fmttime);
+
+/**
+ * Formats the overlay title "close change percent%" and the subtitle
+ * "symbol @ time" of a quote into its `title' and `subtitle'.
+ *
+ * @param data           The quote.
+ * @param change         The change to show.
+ * @param percent_change The percent change to show, with 3 decimals.
+ * @param decimals       Decimals of close and change.
+ */
+void format_quote(stock_data_t *data, price_t change, price_t percent_change, int decimals);
+
+/**
+ * Appends a second subtitle line "VWAP vwap  vol volatility%  z zscore" to
+ * a quote formatted by format_quote(), leaving out what is not known yet.
+ *
+ * @param data     The quote.
+ * @param stats    The statistics of its symbol.
+ * @param decimals Decimals of the VWAP.
+ */
+void format_quote_analytics(stock_data_t *data, const analytics_t *stats, int decimals);
+
+/**
+ * Formats the ticker tape text "symbol close change percent%" of a quote.
+ *
+ * @param dst            Where to write, always terminated.
+ * @param size           Size of `dst'.
+ * @param data           The quote.
+ * @param change         The change to show.
+ * @param percent_change The percent change to show, with 2 decimals.
+ * @param decimals       Decimals of close and change.
+ */
+void format_quote_ticker(char *dst, size_t size, const stock_data_t *data,
+                         price_t change, price_t percent_change, int decimals);
+
+#endif
@@ -0,0 +1,1317 @@
+#ifdef CAIRO
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <errno.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+
+#ifdef __linux__
+  #include <sys/epoll.h>
+  #include <sys/timerfd.h>
+#endif
+
+#include <hiredis/hiredis.h>
+
+#include "redis.h"
+#include "stock.h"
+#include "control.h"
+#include "log.h"
+#include "options.h"
+#include "startup.h"
+#include "symbols.h"
+
+// Replies are carved out of a bump arena instead of being malloc()ed piece
+// by piece by hiredis, and the arena is reset once the replies read so far
+// were handled. It starts at ARENA_SIZE and grows to the largest batch seen.
+#define ARENA_SIZE 65536
+#define ARENA_ALIGN _Alignof(max_align_t)
+
+typedef struct arena_spill {
+    struct arena_spill *next;
+    max_align_t data[];
+} arena_spill_t;
+
+static struct {
+    char *base;
+    size_t size;
+    size_t used;
+    // allocations that did not fit, freed by the next reset
+    arena_spill_t *spill;
+    size_t spilled;
+} arena;
+
+static void *arena_alloc(size_t size)
+{
+    size = (size + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1);
+    if (arena.size - arena.used >= size) {
+        void *p = arena.base + arena.used;
+        arena.used += size;
+        return p;
+    }
+
+    arena_spill_t *spill = malloc(sizeof(arena_spill_t) + size);
+    if (!spill) {
+        return NULL;
+    }
+    spill->next = arena.spill;
+    arena.spill = spill;
+    arena.spilled += size;
+    return spill->data;
+}
+
+static void arena_reset(void)
+{
+    if (arena.spill) {
+        size_t wanted = 2 * (arena.used + arena.spilled);
+        while (arena.spill) {
+            arena_spill_t *next = arena.spill->next;
+            free(arena.spill);
+            arena.spill = next;
+        }
+        arena.spilled = 0;
+
+        // nothing lives in the arena any more, the old block is not copied
+        char *base = malloc(wanted);
+        if (base) {
+            free(arena.base);
+            arena.base = base;
+            arena.size = wanted;
+        }
+    }
+    arena.used = 0;
+}
+
+static void arena_free(void)
+{
+    arena_reset();
+    free(arena.base);
+    arena.base = NULL;
+    arena.size = 0;
+}
+
+// A reply with `extra' bytes behind it for its string or element array,
+// linked into its parent like hiredis' own reply functions do
+static redisReply *arena_reply(const redisReadTask *task, size_t extra)
+{
+    redisReply *r = arena_alloc(sizeof(redisReply) + extra);
+    if (!r) {
+        return NULL;
+    }
+    memset(r, 0, sizeof(redisReply));
+    r->type = task->type;
+    if (task->parent) {
+        redisReply *parent = task->parent->obj;
+        parent->element[task->idx] = r;
+    }
+    return r;
+}
+
+// The strings are copied: hiredis compacts its read buffer before it
+// returns a reply, so they cannot point into it
+static void *arena_string(const redisReadTask *task, char *str, size_t len)
+{
+    const char *vtype = NULL;
+    if (task->type == REDIS_REPLY_VERB && len >= 4) {
+        vtype = str;
+        str += 4;
+        len -= 4;
+    }
+
+    redisReply *r = arena_reply(task, len + 1);
+    if (!r) {
+        return NULL;
+    }
+    if (vtype) {
+        memcpy(r->vtype, vtype, 3);
+    }
+    r->str = (char *)(r + 1);
+    memcpy(r->str, str, len);
+    r->str[len] = '\0';
+    r->len = len;
+    return r;
+}
+
+static void *arena_array(const redisReadTask *task, size_t elements)
+{
+    redisReply *r = arena_reply(task, elements * sizeof(redisReply *));
+    if (!r) {
+        return NULL;
+    }
+    if (elements > 0) {
+        r->element = (redisReply **)(r + 1);
+        memset(r->element, 0, elements * sizeof(redisReply *));
+    }
+    r->elements = elements;
+    return r;
+}
+
+static void *arena_integer(const redisReadTask *task, long long value)
+{
+    redisReply *r = arena_reply(task, 0);
+    if (r) {
+        r->integer = value;
+    }
+    return r;
+}
+
+static void *arena_double(const redisReadTask *task, double value, char *str, size_t len)
+{
+    redisReply *r = arena_string(task, str, len);
+    if (r) {
+        r->dval = value;
+    }
+    return r;
+}
+
+static void *arena_nil(const redisReadTask *task)
+{
+    return arena_reply(task, 0);
+}
+
+static void *arena_bool(const redisReadTask *task, int value)
+{
+    redisReply *r = arena_reply(task, 0);
+    if (r) {
+        r->integer = value != 0;
+    }
+    return r;
+}
+
+// replies are released all at once by arena_reset()
+static void arena_release(void *reply)
+{
+    (void)reply;
+}
+
+static redisReplyObjectFunctions arena_functions = {
+    arena_string,
+    arena_array,
+    arena_integer,
+    arena_double,
+    arena_nil,
+    arena_bool,
+    arena_release,
+};
+
+// One connection to a server. Without a cluster there is just one; with one
+// there is an entry per node, connected once it owns a subscribed channel
+typedef struct {
+    redisContext *ctx;
+    char host[256];
+    int port;
+    // subscriptions the server confirmed on this connection
+    long long subscribed;
+    // with redundant servers: quotes it delivered first and copies it
+    // delivered late, and how far ahead its first copies were in ms
+    unsigned long first;
+    unsigned long late;
+    unsigned long leads;
+    double lead_total;
+    double lead_max;
+} redis_conn_t;
+
+#define REDIS_CONNS_MAX 64
+
+static redis_conn_t conns[REDIS_CONNS_MAX];
+static int conn_count = 0;
+
+// The configured servers: `options.host' is a comma separated list of
+// host[:port], the port defaulting to `options.port'. Without a cluster,
+// each is subscribed to; with one, they are the nodes asked for the slots
+typedef struct {
+    char host[256];
+    int port;
+} redis_host_t;
+
+static redis_host_t seeds[REDIS_CONNS_MAX];
+static int seed_count = 0;
+
+// Redundant servers publish the same quotes. The first copy of a quote is
+// handled and later ones are dropped, recognised by a hash of the record
+// among the last few of its symbol, or by a timestamp older than the
+// newest quote already handled
+#define RECENT_QUOTES 8
+
+typedef struct {
+    uint64_t hash[RECENT_QUOTES];
+    double arrival[RECENT_QUOTES];
+    unsigned char conn[RECENT_QUOTES];
+    unsigned char next;
+    // "YYYY-MM-DD HH:MM:SS" of the newest quote, which sorts as text
+    char newest[20];
+} recent_quotes_t;
+
+// one per symbol, only allocated with several servers
+static recent_quotes_t *recent = NULL;
+
+// Most channels per SUBSCRIBE command, larger lists are split
+#define SUBSCRIBE_BATCH 512
+
+// Total of confirmed subscriptions, to tell when the initial ones completed
+static long long subscribed = 0;
+
+// Sharded pub/sub state: the node owning each hash slot, a connection that
+// stays out of subscribed mode to ask for the slot table, and the
+// descriptor multiplexing all node connections
+#define CLUSTER_SLOTS 16384
+
+static short slot_owner[CLUSTER_SLOTS];
+// the node each symbol is subscribed on, -1 if none
+static short channel_node[SYMBOLS_MAX];
+static redisContext *topology_ctx = NULL;
+// the node it is connected to, an empty address in the slot table
+static char topology_host[256];
+static int epoll_fd = -1;
+// timer retrying channels whose node could not be reached, e.g. during a
+// failover; it shares the descriptor of the node connections
+static int retry_fd = -1;
+#define RETRY_EVENT REDIS_CONNS_MAX
+static char feed_error[128] = "";
+
+static double monotonic_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+static void parse_hosts(void)
+{
+    seed_count = 0;
+    char *list = strdup(options.host ? options.host : "127.0.0.1");
+    if (!list) {
+        return;
+    }
+    for (char *name = strtok(list, ","); name && seed_count < REDIS_CONNS_MAX; name = strtok(NULL, ",")) {
+        redis_host_t *h = &seeds[seed_count++];
+        h->port = options.port;
+        // a single colon separates the port, IPv6 addresses have several
+        // and are put in brackets to add one
+        char *colon = strrchr(name, ':');
+        char *bracket = name[0] == '[' ? strchr(name, ']') : NULL;
+        if (bracket) {
+            *bracket = '\0';
+            name++;
+            colon = bracket[1] == ':' ? bracket + 1 : NULL;
+        } else if (colon != strchr(name, ':')) {
+            colon = NULL;
+        }
+        if (colon) {
+            *colon = '\0';
+            h->port = atoi(colon + 1);
+        }
+        snprintf(h->host, sizeof(h->host), "%s", name);
+    }
+    free(list);
+}
+
+// Channel names with glob characters are subscribed to as patterns
+static bool is_pattern(const char *const channel)
+{
+    return strpbrk(channel, "*?[") != NULL;
+}
+
+// Applies the transport options to the connected socket. Keepalive is set
+// up directly rather than through hiredis, whose interval setter is recent
+static void tune_socket(redisContext *ctx, bool tcp)
+{
+    int fd = ctx->fd;
+
+    if (tcp) {
+        // hiredis disables Nagle too, but a quote must never wait for an ACK
+        int on = 1;
+        if (setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on)) < 0) {
+            __perror__("Cannot set TCP_NODELAY");
+        }
+
+        if (options.keepalive > 0) {
+            if (setsockopt(fd, SOL_SOCKET, SO_KEEPALIVE, &on, sizeof(on)) < 0) {
+                __perror__("Cannot enable TCP keepalive");
+            }
+            // probes start after `keepalive' idle seconds and repeat a third
+            // of that apart, the connection fails after three unanswered
+            int idle = options.keepalive;
+#if defined(TCP_KEEPIDLE)
+            int interval = idle >= 3 ? idle / 3 : 1, count = 3;
+            setsockopt(fd, IPPROTO_TCP, TCP_KEEPIDLE, &idle, sizeof(idle));
+            setsockopt(fd, IPPROTO_TCP, TCP_KEEPINTVL, &interval, sizeof(interval));
+            setsockopt(fd, IPPROTO_TCP, TCP_KEEPCNT, &count, sizeof(count));
+#elif defined(TCP_KEEPALIVE)
+            setsockopt(fd, IPPROTO_TCP, TCP_KEEPALIVE, &idle, sizeof(idle));
+#endif
+        }
+    }
+
+    // a TCP socket got its receive buffer before connecting, see connect_sized()
+    if (!tcp && options.receive_buffer_kb > 0) {
+        int size = options.receive_buffer_kb * 1024;
+        if (setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size)) < 0) {
+            __perror__("Cannot size socket receive buffer");
+        }
+    }
+}
+
+// Connects a TCP socket to `host' and `port' with `options.receive_buffer_kb'
+// set before the handshake: the window scale offered in the SYN follows from
+// the buffer then, and a larger one set later cannot be advertised in full.
+// Reports and returns -1 on failure
+static int connect_sized(const char *const host, int port, struct timeval timeout)
+{
+    char service[8];
+    snprintf(service, sizeof(service), "%d", port);
+    struct addrinfo hints = { .ai_family = AF_UNSPEC, .ai_socktype = SOCK_STREAM };
+    struct addrinfo *addrs;
+    int rc = getaddrinfo(host, service, &hints, &addrs);
+    if (rc != 0) {
+        printf("Error: %s: %s\n", host, gai_strerror(rc));
+        return -1;
+    }
+
+    int fd = -1, error = 0;
+    int size = options.receive_buffer_kb * 1024;
+    struct timeval none = { 0, 0 };
+    for (struct addrinfo *a = addrs; a && fd < 0; a = a->ai_next) {
+        fd = socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+        if (fd < 0) {
+            error = errno;
+            continue;
+        }
+        if (setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size)) < 0) {
+            __perror__("Cannot size socket receive buffer");
+        }
+        // the send timeout bounds connect(), and is lifted again after it
+        setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+        if (connect(fd, a->ai_addr, a->ai_addrlen) < 0) {
+            error = errno;
+            close(fd);
+            fd = -1;
+            continue;
+        }
+        setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &none, sizeof(none));
+    }
+    freeaddrinfo(addrs);
+
+    if (fd < 0) {
+        printf("Error: Connection to %s:%d failed: %s\n", host, port, strerror(error));
+    }
+    return fd;
+}
+
+// Connects to `host' and `port', or to `socket' if given, with replies built
+// in the arena. Reports and returns NULL on failure
+static redisContext *connect_to(const char *const host, int port, const char *const socket)
+{
+    struct timeval timeout = { 1, 500000 }; // 1.5 seconds
+
+    redisContext *ctx;
+    if (socket) {
+        ctx = redisConnectUnixWithTimeout(socket, timeout);
+    } else if (options.receive_buffer_kb > 0) {
+        int fd = connect_sized(host, port, timeout);
+        if (fd < 0) {
+            return NULL;
+        }
+        ctx = redisConnectFd(fd);
+        if (!ctx) {
+            close(fd);
+        }
+    } else {
+        ctx = redisConnectWithTimeout(host, port, timeout);
+    }
+    if (!ctx || ctx->err) {
+        if (ctx) {
+            printf("Error: %s\n", ctx->errstr);
+            redisFree(ctx);
+        } else {
+            printf("Error: Can't allocate redis context\n");
+        }
+        return NULL;
+    }
+
+    if (socket) {
+        __info__("Connected to Redis server at %s\n", socket);
+    } else {
+        __info__("Connected to Redis server %s:%d\n", host, port);
+    }
+    tune_socket(ctx, socket == NULL);
+
+    // from here on replies must not be given to freeReplyObject()
+    ctx->reader->fn = &arena_functions;
+    return ctx;
+}
+
+// Queues one batched command on connection `target', or on every connected
+// server if it is -1
+static void append_batch(int target, const char **argv, int *argc)
+{
+    for (int i = 0; i < conn_count && *argc > 1; i++) {
+        if ((target < 0 || target == i) && conns[i].ctx) {
+            redisAppendCommandArgv(conns[i].ctx, *argc, argv, NULL);
+        }
+    }
+    *argc = 1;
+}
+
+// The entry of a server, added unconnected if it is new
+static int conn_add(const char *const host, int port)
+{
+    for (int i = 0; i < conn_count; i++) {
+        if (conns[i].port == port && strcmp(conns[i].host, host) == 0) {
+            return i;
+        }
+    }
+    if (conn_count == REDIS_CONNS_MAX) {
+        __error__("Too many Redis servers, ignoring %s:%d\n", host, port);
+        return -1;
+    }
+
+    redis_conn_t *c = &conns[conn_count];
+    memset(c, 0, sizeof(redis_conn_t));
+    snprintf(c->host, sizeof(c->host), "%s", host);
+    c->port = port;
+    return conn_count++;
+}
+
+static bool conn_open(int node)
+{
+    redis_conn_t *c = &conns[node];
+    if (c->ctx) {
+        return true;
+    }
+
+    c->ctx = connect_to(c->host, c->port, options.redis_socket);
+    if (!c->ctx) {
+        return false;
+    }
+#ifdef __linux__
+    struct epoll_event event = { .events = EPOLLIN, .data.u32 = node };
+    if (epoll_fd >= 0 && epoll_ctl(epoll_fd, EPOLL_CTL_ADD, c->ctx->fd, &event) < 0) {
+        __perror__("Cannot wait for Redis server");
+        redisFree(c->ctx);
+        c->ctx = NULL;
+        return false;
+    }
+#endif
+    c->subscribed = 0;
+    return true;
+}
+
+static void conn_close(int node)
+{
+    redis_conn_t *c = &conns[node];
+    if (c->ctx) {
+#ifdef __linux__
+        if (epoll_fd >= 0) {
+            epoll_ctl(epoll_fd, EPOLL_CTL_DEL, c->ctx->fd, NULL);
+        }
+#endif
+        redisFree(c->ctx);
+        c->ctx = NULL;
+    }
+    subscribed -= c->subscribed;
+    c->subscribed = 0;
+
+    for (int i = 0; i < SYMBOLS_MAX; i++) {
+        if (channel_node[i] == node) {
+            channel_node[i] = -1;
+        }
+    }
+}
+
+// Waits for all connections and the retry timer on one descriptor
+static int multiplex_start(void)
+{
+#ifdef __linux__
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    retry_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    struct epoll_event event = { .events = EPOLLIN, .data.u32 = RETRY_EVENT };
+    if (epoll_fd < 0 || retry_fd < 0 || epoll_ctl(epoll_fd, EPOLL_CTL_ADD, retry_fd, &event) < 0) {
+        __perror__("Cannot wait for Redis servers");
+        return -1;
+    }
+    return 0;
+#else
+    __error__("Several Redis connections are only supported on Linux\n");
+    return -1;
+#endif
+}
+
+#ifdef __linux__
+static void retry_later(void)
+{
+    struct itimerspec retry = { .it_value = { 1, 0 } };
+    timerfd_settime(retry_fd, 0, &retry, NULL);
+}
+#else
+static void retry_later(void)
+{
+}
+#endif
+
+static void append_difference(int target, const char *const command, const Options *const from,
+                              const Options *const without);
+
+// A redundant server failed: the others carry on and it is reconnected to
+// every second. Only fatal once none is left
+static int host_failed(int node)
+{
+    printf("Redis server %s:%d failed: %s\n", conns[node].host, conns[node].port, conns[node].ctx->errstr);
+    conn_close(node);
+    retry_later();
+    for (int i = 0; i < conn_count; i++) {
+        if (conns[i].ctx) {
+            return 0;
+        }
+    }
+    snprintf(feed_error, sizeof(feed_error), "No Redis server reachable");
+    return -1;
+}
+
+#ifdef __linux__
+static int hosts_retry(void)
+{
+    uint64_t expirations;
+    if (read(retry_fd, &expirations, sizeof(expirations)) < 0) {
+        return 0;
+    }
+
+    Options none = { 0 };
+    bool missing = false;
+    for (int i = 0; i < conn_count; i++) {
+        if (conns[i].ctx) {
+            continue;
+        }
+        if (conn_open(i)) {
+            __info__("Reconnected to %s:%d\n", conns[i].host, conns[i].port);
+            append_difference(i, "SUBSCRIBE", &options, &none);
+        } else {
+            missing = true;
+        }
+    }
+    if (missing) {
+        retry_later();
+    }
+    return 0;
+}
+#else
+static int hosts_retry(void)
+{
+    return 0;
+}
+#endif
+
+#ifdef __linux__
+
+// CRC16-CCITT (XModem), which Redis Cluster hashes keys and channels with
+static unsigned crc16(const char *buf, size_t len)
+{
+    unsigned crc = 0;
+    for (size_t i = 0; i < len; i++) {
+        crc ^= (unsigned char)buf[i] << 8;
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+        }
+    }
+    return crc & 0xffff;
+}
+
+// The hash slot of a channel; a non-empty {tag} is hashed instead of the
+// whole name, so related channels can be kept on one node
+static int key_slot(const char *const name)
+{
+    const char *open = strchr(name, '{');
+    if (open) {
+        const char *close = strchr(open + 1, '}');
+        if (close && close > open + 1) {
+            return crc16(open + 1, close - open - 1) % CLUSTER_SLOTS;
+        }
+    }
+    return crc16(name, strlen(name)) % CLUSTER_SLOTS;
+}
+
+// Reads the slot table with CLUSTER SLOTS, reconnecting to a configured
+// node or any known one if the previous topology connection was lost
+static int cluster_refresh(void)
+{
+    for (int i = 0; !topology_ctx && i < seed_count + conn_count; i++) {
+        const char *host = i < seed_count ? seeds[i].host : conns[i - seed_count].host;
+        int port = i < seed_count ? seeds[i].port : conns[i - seed_count].port;
+        topology_ctx = connect_to(host, port, NULL);
+        if (topology_ctx) {
+            snprintf(topology_host, sizeof(topology_host), "%s", host);
+        }
+    }
+    if (!topology_ctx) {
+        snprintf(feed_error, sizeof(feed_error), "No cluster node reachable");
+        return -1;
+    }
+
+    // replies live in the arena until the current batch was handled
+    redisReply *reply = redisCommand(topology_ctx, "CLUSTER SLOTS");
+    if (!reply || reply->type != REDIS_REPLY_ARRAY) {
+        printf("Cannot read cluster slots: %s\n",
+               reply && reply->type == REDIS_REPLY_ERROR ? reply->str : topology_ctx->errstr);
+        redisFree(topology_ctx);
+        topology_ctx = NULL;
+        return -1;
+    }
+
+    for (int slot = 0; slot < CLUSTER_SLOTS; slot++) {
+        slot_owner[slot] = -1;
+    }
+    for (size_t i = 0; i < reply->elements; i++) {
+        const redisReply *range = reply->element[i];
+        if (range->type != REDIS_REPLY_ARRAY || range->elements < 3 ||
+            range->element[2]->type != REDIS_REPLY_ARRAY || range->element[2]->elements < 2) {
+            continue;
+        }
+        // the master comes first; an empty address is the one asked
+        const redisReply *master = range->element[2];
+        const char *node_host = master->element[0]->str;
+        if (node_host == NULL || node_host[0] == '\0' || strcmp(node_host, "?") == 0) {
+            node_host = topology_host;
+        }
+        int node = conn_add(node_host, (int)master->element[1]->integer);
+        long long first = range->element[0]->integer, last = range->element[1]->integer;
+        for (long long slot = first; node >= 0 && slot <= last && slot < CLUSTER_SLOTS; slot++) {
+            if (slot >= 0) {
+                slot_owner[slot] = node;
+            }
+        }
+    }
+    __info__("Read the slots of %d cluster nodes\n", conn_count);
+    return 0;
+}
+
+// Subscribes to a channel on the node owning its slot, or unsubscribes from
+// it on the node it was subscribed on
+static bool cluster_append(const char *const command, const char *const channel)
+{
+    int symbol = symbol_slot(channel);
+    if (symbol < 0) {
+        return false;
+    }
+
+    bool subscribe = strcmp(command, "SSUBSCRIBE") == 0;
+    int node = subscribe ? slot_owner[key_slot(channel)] : channel_node[symbol];
+    if (node < 0) {
+        if (subscribe) {
+            __error__("No cluster node serves channel %s\n", channel);
+        }
+        return !subscribe;
+    }
+    if (!conn_open(node)) {
+        return false;
+    }
+
+    __info__("%s %s on %s:%d\n", command, channel, conns[node].host, conns[node].port);
+    const char *argv[] = { command, channel };
+    redisAppendCommandArgv(conns[node].ctx, 2, argv, NULL);
+    channel_node[symbol] = subscribe ? node : -1;
+    return true;
+}
+
+// Marks a channel as subscribed nowhere, after its node refused or dropped it
+static void cluster_forget(const char *const channel)
+{
+    int symbol = symbol_find(channel);
+    if (symbol >= 0) {
+        channel_node[symbol] = -1;
+    }
+}
+
+// Subscribes to every channel that is not subscribed on the current owner
+// of its slot: at startup all of them, later those on a failed node or in a
+// slot that moved. Channels that cannot be placed now are retried a second
+// later
+static void cluster_resubscribe(void)
+{
+    bool placed = true;
+    for (int i = 0; i < options.channel_count; i++) {
+        const char *name = options.channels[i];
+        int symbol = symbol_slot(name);
+        if (is_pattern(name) || symbol < 0) {
+            continue;
+        }
+        int owner = slot_owner[key_slot(name)];
+        if (owner >= 0 && channel_node[symbol] == owner) {
+            continue;
+        }
+        placed &= cluster_append("SSUBSCRIBE", name);
+    }
+
+    if (!placed) {
+        retry_later();
+    }
+}
+
+// A node connection failed: its subscriptions move to whichever node serves
+// their slots now, e.g. the replica promoted in its place
+static int cluster_failover(int node)
+{
+    printf("Redis cluster node %s:%d failed: %s\n", conns[node].host, conns[node].port,
+           conns[node].ctx->errstr);
+    conn_close(node);
+    if (cluster_refresh() < 0) {
+        // only fatal once no node answers at all
+        retry_later();
+        return feed_error[0] ? -1 : 0;
+    }
+    cluster_resubscribe();
+    return 0;
+}
+
+static int cluster_retry(void)
+{
+    uint64_t expirations;
+    if (read(retry_fd, &expirations, sizeof(expirations)) < 0) {
+        return 0;
+    }
+    if (cluster_refresh() < 0) {
+        retry_later();
+        return feed_error[0] ? -1 : 0;
+    }
+    cluster_resubscribe();
+    return 0;
+}
+
+// Follows a -MOVED or -ASK redirection for an SSUBSCRIBE
+static void cluster_redirect(const char *const error)
+{
+    int slot;
+    char target[300];
+    if (sscanf(error, "%*s %d %299s", &slot, target) != 2 || slot < 0 || slot >= CLUSTER_SLOTS) {
+        printf("Redis error: %s\n", error);
+        return;
+    }
+
+    // the subscriptions to the slot were refused
+    for (int i = 0; i < options.channel_count; i++) {
+        if (key_slot(options.channels[i]) == slot) {
+            cluster_forget(options.channels[i]);
+        }
+    }
+
+    if (strncmp(error, "MOVED ", 6) == 0) {
+        // only this slot moved, it is taken over directly
+        char *colon = strrchr(target, ':');
+        if (colon) {
+            *colon = '\0';
+            int node = conn_add(target, atoi(colon + 1));
+            if (node >= 0) {
+                slot_owner[slot] = node;
+            }
+        }
+    } else if (cluster_refresh() < 0) {
+        retry_later();
+        return;
+    }
+    __info__("Slot %d is served by %s now\n", slot, target);
+    cluster_resubscribe();
+}
+
+static int cluster_start(void)
+{
+    parse_hosts();
+    if (options.redis_socket) {
+        __error__("Cluster nodes are reached over TCP, --redis-socket does not apply\n");
+        return -1;
+    }
+    if (multiplex_start() < 0) {
+        return -1;
+    }
+    for (int i = 0; i < SYMBOLS_MAX; i++) {
+        channel_node[i] = -1;
+    }
+    if (cluster_refresh() < 0) {
+        return -1;
+    }
+    startup_trace("redis cluster slots read");
+
+    for (int i = 0; i < options.channel_count; i++) {
+        if (is_pattern(options.channels[i])) {
+            __error__("Sharded pub/sub has no patterns, ignoring %s\n", options.channels[i]);
+        }
+    }
+    cluster_resubscribe();
+    return 0;
+}
+
+#else
+
+static void cluster_forget(const char *const channel)
+{
+    (void)channel;
+}
+
+static bool cluster_append(const char *const command, const char *const channel)
+{
+    (void)command;
+    (void)channel;
+    return false;
+}
+
+static void cluster_resubscribe(void)
+{
+}
+
+static int cluster_failover(int node)
+{
+    (void)node;
+    return -1;
+}
+
+static int cluster_retry(void)
+{
+    return -1;
+}
+
+static void cluster_redirect(const char *const error)
+{
+    printf("Redis error: %s\n", error);
+}
+
+static int cluster_start(void)
+{
+    __error__("Redis Cluster support is only available on Linux\n");
+    return -1;
+}
+
+#endif
+
+// Queues `command' for all channels of `from' that are not in `without',
+// on connection `target' or, if it is -1, on every connected server.
+// Patterns use its P-prefixed variant, and a cluster the S-prefixed one
+static void append_difference(int target, const char *const command, const Options *const from,
+                              const Options *const without)
+{
+    char pcommand[16], scommand[16];
+    snprintf(pcommand, sizeof(pcommand), "P%s", command);
+    snprintf(scommand, sizeof(scommand), "S%s", command);
+
+    const char *channels[SUBSCRIBE_BATCH + 1] = { command };
+    const char *patterns[SUBSCRIBE_BATCH + 1] = { pcommand };
+    int channel_argc = 1, pattern_argc = 1;
+
+    for (int i = 0; i < from->channel_count; i++) {
+        bool found = false;
+        for (int j = 0; j < without->channel_count && !found; j++) {
+            found = strcmp(from->channels[i], without->channels[j]) == 0;
+        }
+        if (found) {
+            continue;
+        }
+
+        const char *name = from->channels[i];
+        bool pattern = is_pattern(name);
+        if (options.cluster) {
+            if (pattern) {
+                __error__("Sharded pub/sub has no patterns, ignoring %s\n", name);
+            } else {
+                cluster_append(scommand, name);
+            }
+            continue;
+        }
+
+        const char **argv = pattern ? patterns : channels;
+        int *argc = pattern ? &pattern_argc : &channel_argc;
+        __info__("%s %s\n", argv[0], name);
+        argv[(*argc)++] = name;
+        if (*argc == SUBSCRIBE_BATCH + 1) {
+            append_batch(target, argv, argc);
+        }
+    }
+    if (!options.cluster) {
+        append_batch(target, channels, &channel_argc);
+        append_batch(target, patterns, &pattern_argc);
+    }
+}
+
+// Writes the queued commands of all connections without waiting for their
+// replies
+static int flush_commands(void)
+{
+    int rc = 0;
+    for (int i = 0; i < conn_count; i++) {
+        redisContext *ctx = conns[i].ctx;
+        int done = 0;
+        while (ctx && !done) {
+            if (redisBufferWrite(ctx, &done) != REDIS_OK) {
+                printf("Redis error: %s\n", ctx->errstr);
+                rc = -1;
+                break;
+            }
+        }
+    }
+    return rc;
+}
+
+static void arena_reset_if_idle(void)
+{
+    // a reply still being read lives in the arena too
+    for (int i = 0; i < conn_count; i++) {
+        if (conns[i].ctx && conns[i].ctx->reader->ridx >= 0) {
+            return;
+        }
+    }
+    arena_reset();
+}
+
+int redis_start(void)
+{
+    arena.base = malloc(ARENA_SIZE);
+    arena.size = arena.base ? ARENA_SIZE : 0;
+    subscribed = 0;
+
+    if (options.cluster) {
+        if (cluster_start() < 0) {
+            redis_stop();
+            return -1;
+        }
+    } else {
+        parse_hosts();
+        // a Unix socket is the one local server
+        int count = options.redis_socket ? 1 : seed_count;
+        for (int i = 0; i < count; i++) {
+            conn_add(seeds[i].host, seeds[i].port);
+        }
+        if (conn_count > 1) {
+            recent = calloc(SYMBOLS_MAX, sizeof(recent_quotes_t));
+            if (!recent || multiplex_start() < 0) {
+                redis_stop();
+                return -1;
+            }
+        }
+
+        // all channels go out in one write per server, the confirmations
+        // are read by the event loop while the display is set up
+        Options none = { 0 };
+        int connected = 0;
+        for (int i = 0; i < conn_count; i++) {
+            if (conn_open(i)) {
+                append_difference(i, "SUBSCRIBE", &options, &none);
+                connected++;
+            }
+        }
+        if (connected == 0) {
+            redis_stop();
+            return -1;
+        }
+        if (connected < conn_count) {
+            retry_later();
+        }
+        startup_trace("redis connected");
+    }
+
+    if (flush_commands() < 0) {
+        redis_stop();
+        return -1;
+    }
+    startup_trace("redis subscriptions sent");
+    arena_reset_if_idle();
+
+    return 0;
+}
+
+int redis_fd(void)
+{
+    return epoll_fd >= 0 ? epoll_fd : conns[0].ctx->fd;
+}
+
+const char *redis_error(void)
+{
+    if (epoll_fd >= 0) {
+        return feed_error[0] ? feed_error : NULL;
+    }
+    return conn_count > 0 && conns[0].ctx && conns[0].ctx->err ? conns[0].ctx->errstr : NULL;
+}
+
+int redis_host_stats(redis_host_stats_t *stats, int max)
+{
+    if (!recent) {
+        return 0;
+    }
+    int n = 0;
+    for (; n < conn_count && n < max; n++) {
+        const redis_conn_t *c = &conns[n];
+        stats[n] = (redis_host_stats_t) {
+            .host = c->host,
+            .port = c->port,
+            .connected = c->ctx != NULL,
+            .first = c->first,
+            .late = c->late,
+            .lead_ms_avg = c->leads ? c->lead_total / c->leads : 0,
+            .lead_ms_max = c->lead_max,
+        };
+    }
+    return n;
+}
+
+static bool is_subscribed(const char *const channel)
+{
+    for (int i = 0; i < options.channel_count; i++) {
+        if (strcmp(options.channels[i], channel) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static uint64_t quote_hash(const char *s)
+{
+    // FNV-1a
+    uint64_t hash = 14695981039346656037ull;
+    for (; *s; s++) {
+        hash = (hash ^ (unsigned char)*s) * 1099511628211ull;
+    }
+    return hash;
+}
+
+// With several servers: whether this is the first copy of a quote. A copy
+// arriving later credits the server that was first with its lead
+static bool first_copy(int index, const char *const channel, const char *const message)
+{
+    int symbol = recent ? symbol_slot(channel) : -1;
+    if (symbol < 0) {
+        return true;
+    }
+
+    recent_quotes_t *r = &recent[symbol];
+    uint64_t hash = quote_hash(message);
+    double now = monotonic_ms();
+    for (int i = 0; i < RECENT_QUOTES; i++) {
+        if (r->arrival[i] == 0 || r->hash[i] != hash) {
+            continue;
+        }
+        if (r->conn[i] != index) {
+            redis_conn_t *winner = &conns[r->conn[i]];
+            double lead = now - r->arrival[i];
+            winner->leads++;
+            winner->lead_total += lead;
+            if (lead > winner->lead_max) {
+                winner->lead_max = lead;
+            }
+            conns[index].late++;
+        }
+        control_stats.duplicates++;
+        return false;
+    }
+
+    // older than a quote already shown: a server lagging by more than the
+    // remembered quotes
+    if (strlen(message) >= sizeof(r->newest) - 1) {
+        if (strncmp(message, r->newest, sizeof(r->newest) - 1) < 0) {
+            conns[index].late++;
+            control_stats.duplicates++;
+            return false;
+        }
+        memcpy(r->newest, message, sizeof(r->newest) - 1);
+    }
+
+    r->hash[r->next] = hash;
+    r->arrival[r->next] = now;
+    r->conn[r->next] = index;
+    r->next = (r->next + 1) % RECENT_QUOTES;
+    conns[index].first++;
+    return true;
+}
+
+static void handle_reply(redis_conn_t *const conn, const redisReply *const reply)
+{
+    int index = conn - conns;
+    if (reply->type == REDIS_REPLY_ARRAY && reply->elements >= 3) {
+        char* message_type = reply->element[0]->str;
+        char* channel = reply->element[1]->str;
+
+        if (strcmp(message_type, "message") == 0 || strcmp(message_type, "smessage") == 0) {
+            char* message = reply->element[2]->str;
+            __info__("Redis message - Type: %s, Channel: %s, Data: %s\n", message_type, channel, message);
+            control_stats.messages++;
+            if (first_copy(index, channel, message)) {
+                stock_message(channel, message);
+            }
+        } else if (strcmp(message_type, "pmessage") == 0 && reply->elements >= 4) {
+            // the pattern comes first, then the channel that matched it
+            channel = reply->element[2]->str;
+            char* message = reply->element[3]->str;
+            __info__("Redis message - Type: %s, Channel: %s, Data: %s\n", message_type, channel, message);
+            control_stats.messages++;
+            if (first_copy(index, channel, message)) {
+                stock_message(channel, message);
+            }
+        } else if (strcmp(message_type, "subscribe") == 0 || strcmp(message_type, "psubscribe") == 0 ||
+                   strcmp(message_type, "ssubscribe") == 0) {
+            __debug__("Subscription confirmed for: %s\n", channel);
+            // the confirmation carries the number of subscriptions so far;
+            // a cluster spreads the channels over its nodes, redundant
+            // servers each have all of them
+            long long before = options.cluster ? subscribed : conn->subscribed;
+            subscribed += reply->element[2]->integer - conn->subscribed;
+            conn->subscribed = reply->element[2]->integer;
+            long long now = options.cluster ? subscribed : conn->subscribed;
+            if (before < options.channel_count && now >= options.channel_count) {
+                if (options.cluster || conn_count == 1) {
+                    printf("Successfully subscribed to %d channels\n", options.channel_count);
+                } else {
+                    printf("Successfully subscribed to %d channels on %s:%d\n", options.channel_count,
+                           conn->host, conn->port);
+                }
+                startup_trace("redis subscriptions confirmed");
+            }
+        } else if (strcmp(message_type, "unsubscribe") == 0 || strcmp(message_type, "punsubscribe") == 0 ||
+                   strcmp(message_type, "sunsubscribe") == 0) {
+            subscribed += reply->element[2]->integer - conn->subscribed;
+            conn->subscribed = reply->element[2]->integer;
+            if (options.cluster && is_subscribed(channel)) {
+                // not asked for: the node gave the channel's slot away
+                // subscribing again where the slot table says is answered
+                // with a -MOVED to the new owner if it is outdated
+                __info__("Channel %s moved off %s:%d\n", channel, conn->host, conn->port);
+                cluster_forget(channel);
+                cluster_resubscribe();
+            } else {
+                __info__("Unsubscribed from channel: %s\n", channel);
+                stock_forget(channel);
+            }
+        }
+    } else if (reply->type == REDIS_REPLY_ERROR && options.cluster &&
+               (strncmp(reply->str, "MOVED ", 6) == 0 || strncmp(reply->str, "ASK ", 4) == 0)) {
+        cluster_redirect(reply->str);
+    } else if (reply->type == REDIS_REPLY_ERROR) {
+        printf("Redis error: %s\n", reply->str);
+    } else {
+        printf("Unexpected reply type: %d\n", reply->type);
+    }
+}
+
+// Handles every reply the next read of one connection brings
+static int drain(int index)
+{
+    redis_conn_t *conn = &conns[index];
+    redisReply *reply;
+
+    // Use redisGetReply to read the next reply
+    if (redisGetReply(conn->ctx, (void**)&reply) != REDIS_OK) {
+        if (conn->ctx->err) {
+            printf("Redis error: %s\n", conn->ctx->errstr);
+            return -1;
+        }
+        return 0; // No data available
+    }
+
+    // a read often brings several messages, all are handled before the
+    // arena is reused
+    int handled = 0;
+    while (reply) {
+        handle_reply(conn, reply);
+        handled++;
+        if (redisGetReplyFromReader(conn->ctx, (void**)&reply) != REDIS_OK) {
+            printf("Redis error: %s\n", conn->ctx->errstr);
+            return -1;
+        }
+    }
+    return handled;
+}
+
+// Function to handle Redis pub/sub messages
+int handle_redis_messages() {
+    int handled = 0;
+
+    if (epoll_fd < 0) {
+        handled = drain(0);
+        if (handled < 0) {
+            return -1;
+        }
+    } else {
+#ifdef __linux__
+        struct epoll_event events[16];
+        int ready = epoll_wait(epoll_fd, events, 16, 0);
+        for (int i = 0; i < ready; i++) {
+            int node = events[i].data.u32;
+            if (node == RETRY_EVENT) {
+                if ((options.cluster ? cluster_retry() : hosts_retry()) < 0) {
+                    return -1;
+                }
+                continue;
+            }
+            if (!conns[node].ctx) {
+                continue;
+            }
+            int n = drain(node);
+            if (n < 0 && (options.cluster ? cluster_failover(node) : host_failed(node)) < 0) {
+                return -1;
+            }
+            handled += n > 0 ? n : 0;
+        }
+        // subscriptions queued while following moved slots or for a server
+        // that is back
+        flush_commands();
+#endif
+    }
+
+    arena_reset_if_idle();
+    return handled;
+}
+
+void redis_update_subscriptions(const Options *const previous)
+{
+    if (previous->channels == options.channels) {
+        return;
+    }
+    if (conn_count == 0) {
+        // quotes come from the quote board, which is filtered by the
+        // channels directly; no unsubscribe will be confirmed
+        for (int i = 0; i < previous->channel_count; i++) {
+            bool found = false;
+            for (int j = 0; j < options.channel_count && !found; j++) {
+                found = strcmp(previous->channels[i], options.channels[j]) == 0;
+            }
+            if (!found) {
+                stock_forget(previous->channels[i]);
+            }
+        }
+        return;
+    }
+    append_difference(-1, "SUBSCRIBE", &options, previous);
+    append_difference(-1, "UNSUBSCRIBE", previous, &options);
+    flush_commands();
+}
+
+void redis_stop(void)
+{
+    for (int i = 0; i < conn_count; i++) {
+        if (conns[i].ctx) {
+            redisFree(conns[i].ctx);
+            conns[i].ctx = NULL;
+        }
+    }
+    conn_count = 0;
+    seed_count = 0;
+    free(recent);
+    recent = NULL;
+    feed_error[0] = '\0';
+    if (topology_ctx) {
+        redisFree(topology_ctx);
+        topology_ctx = NULL;
+    }
+    if (retry_fd >= 0) {
+        close(retry_fd);
+        retry_fd = -1;
+    }
+    if (epoll_fd >= 0) {
+        close(epoll_fd);
+        epoll_fd = -1;
+    }
+    arena_free();
+}
+
+#endif
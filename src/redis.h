@@ -0,0 +1,80 @@
+#ifndef INCLUDE_REDIS_H
+#define INCLUDE_REDIS_H
+
+#include <stdbool.h>
+#include "options.h"
+
+/**
+ * Struct with the arrival statistics of one of several redundant servers.
+ */
+typedef struct redis_host_stats_t {
+  const char *host;
+  int port;
+  bool connected;
+  // quotes it delivered before any other server
+  unsigned long first;
+  // copies it delivered after another server, which were dropped
+  unsigned long late;
+  // how far its first copies were ahead of the next copy, in milliseconds
+  double lead_ms_avg;
+  double lead_ms_max;
+} redis_host_stats_t;
+
+/**
+ * Connects to the Redis servers and subscribes to `options.channels'.
+ *
+ * `options.host' may list several servers, separated by commas, each as
+ * host or host:port. All of them are subscribed to and every quote is
+ * handled once, as soon as its first copy arrived. A server that fails is
+ * reconnected to in the background while the others carry on.
+ *
+ * @returns 0 on success, -1 otherwise.
+ */
+int redis_start(void);
+
+/**
+ * @returns The descriptor of the subscription, to wait on for messages.
+ */
+int redis_fd(void);
+
+/**
+ * Reads from the connection and handles every pub/sub message it brought,
+ * handing quotes to stock_message().
+ *
+ * @returns The number of messages handled, 0 if none was available, -1 on
+ *          connection errors.
+ */
+int handle_redis_messages(void);
+
+/**
+ * @returns The connection error, or NULL while the connection is fine.
+ */
+const char *redis_error(void);
+
+/**
+ * Reports how the redundant servers compare.
+ *
+ * @param stats Receives one entry per server.
+ * @param max   Size of `stats'.
+ *
+ * @returns The number of entries filled, 0 unless several servers are
+ *          subscribed to.
+ */
+int redis_host_stats(redis_host_stats_t *stats, int max);
+
+/**
+ * Subscribes to the channels added since `previous' and unsubscribes from
+ * the ones removed, on the existing connection. Confirmations arrive as
+ * regular messages. Without a connection, i.e. when attached to the quote
+ * board, removed symbols are just dropped from the display.
+ *
+ * @param previous The options the current subscriptions were made for.
+ */
+void redis_update_subscriptions(const Options *const previous);
+
+/**
+ * Closes the connection.
+ */
+void redis_stop(void);
+
+#endif
@@ -0,0 +1,233 @@
+#ifdef CAIRO
+
+#include "rotation.h"
+#include "cairo_draw_text.h"
+#include "sparkline.h"
+#include "symbols.h"
+#include "options.h"
+#include "log.h"
+#include <cairo/cairo.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+    char title[64];
+    char subtitle[64];
+    rgba_color color;
+    unsigned version;
+} rotation_quote_t;
+
+// one rendered overlay, linked into the LRU list
+typedef struct rotation_frame_t {
+    struct rotation_frame_t *prev, *next;
+    int slot;
+    unsigned version;
+    float scale;
+    cairo_surface_t *surface;
+    size_t bytes;
+} rotation_frame_t;
+
+static rotation_quote_t *quotes[SYMBOLS_MAX];
+// only the latest version of a symbol is worth keeping, so at most one
+// frame per symbol
+static rotation_frame_t *frames[SYMBOLS_MAX];
+
+// most recently used first
+static rotation_frame_t *lru_head = NULL, *lru_tail = NULL;
+static size_t cache_bytes = 0;
+
+static int shown = -1;
+
+bool rotation_update(const char *const symbol, const char *const title,
+                     const char *const subtitle, rgba_color color)
+{
+    int slot = symbol_slot(symbol);
+    if (slot < 0) {
+        return false;
+    }
+
+    rotation_quote_t *q = quotes[slot];
+    if (!q) {
+        q = quotes[slot] = calloc(1, sizeof(rotation_quote_t));
+        if (!q) {
+            __error__("Cannot allocate rotation entry for %s\n", symbol);
+            return false;
+        }
+    } else if (strcmp(q->title, title) == 0 && strcmp(q->subtitle, subtitle) == 0 &&
+               memcmp(&q->color, &color, sizeof(color)) == 0) {
+        return slot == shown;
+    }
+
+    strncpy(q->title, title, sizeof(q->title) - 1);
+    strncpy(q->subtitle, subtitle, sizeof(q->subtitle) - 1);
+    q->color = color;
+    q->version++;
+
+    if (shown < 0) {
+        shown = slot;
+    }
+    return slot == shown;
+}
+
+bool rotation_next(void)
+{
+    int count = symbol_count();
+    for (int i = 1; i <= count; i++) {
+        int slot = (shown + i) % count;
+        if (quotes[slot]) {
+            bool changed = slot != shown;
+            shown = slot;
+            return changed;
+        }
+    }
+    return false;
+}
+
+static void lru_unlink(rotation_frame_t *f)
+{
+    if (f->prev) f->prev->next = f->next; else lru_head = f->next;
+    if (f->next) f->next->prev = f->prev; else lru_tail = f->prev;
+    f->prev = f->next = NULL;
+}
+
+static void lru_push_front(rotation_frame_t *f)
+{
+    f->next = lru_head;
+    if (lru_head) lru_head->prev = f;
+    lru_head = f;
+    if (!lru_tail) lru_tail = f;
+}
+
+static void frame_free(rotation_frame_t *f)
+{
+    lru_unlink(f);
+    frames[f->slot] = NULL;
+    cache_bytes -= f->bytes;
+    cairo_surface_destroy(f->surface);
+    free(f);
+}
+
+// runs the regular draw_text() pass with the content of `slot'
+static void draw_symbol(cairo_t *const cr, int slot, int xshape_mask)
+{
+    rotation_quote_t *q = quotes[slot];
+
+    Options orig = options;
+    options.title = q->title;
+    options.subtitle = q->subtitle;
+    options.text_color = q->color;
+    options.display_mode = DISPLAY_STATIC;
+    sparkline_select(symbol_name(slot));
+
+    draw_text(cr, xshape_mask);
+
+    options = orig;
+}
+
+// renders the overlay of `slot' into its cached frame
+static rotation_frame_t *frame_render(int slot)
+{
+    rotation_quote_t *q = quotes[slot];
+    int width = options.overlay_width * options.scale;
+    int height = options.overlay_height * options.scale;
+
+    rotation_frame_t *f = frames[slot];
+    if (f && f->scale != options.scale) {
+        frame_free(f);
+        f = NULL;
+    }
+    if (!f) {
+        f = calloc(1, sizeof(rotation_frame_t));
+        if (!f) {
+            return NULL;
+        }
+        f->slot = slot;
+        f->scale = options.scale;
+        f->surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, width, height);
+        f->bytes = (size_t)cairo_image_surface_get_stride(f->surface) * height;
+        frames[slot] = f;
+        cache_bytes += f->bytes;
+    } else {
+        lru_unlink(f);
+    }
+    lru_push_front(f);
+    f->version = q->version;
+
+    __debug__("Rendering rotation frame for %s, version %u\n", symbol_name(slot), q->version);
+
+    cairo_t *cr = cairo_create(f->surface);
+    draw_symbol(cr, slot, 0);
+    cairo_destroy(cr);
+    cairo_surface_flush(f->surface);
+
+    // evict least recently used frames, always keeping the one just drawn
+    size_t limit = (size_t)options.frame_cache_kb * 1024;
+    while (cache_bytes > limit && lru_tail != f) {
+        __debug__("Evicting rotation frame for %s\n", symbol_name(lru_tail->slot));
+        frame_free(lru_tail);
+    }
+
+    return f;
+}
+
+bool rotation_remove(const char *const symbol)
+{
+    int slot = symbol_find(symbol);
+    if (slot < 0 || !quotes[slot]) {
+        return false;
+    }
+
+    if (frames[slot]) {
+        frame_free(frames[slot]);
+    }
+    free(quotes[slot]);
+    quotes[slot] = NULL;
+
+    if (slot != shown) {
+        return false;
+    }
+    if (!rotation_next()) {
+        shown = -1;
+    }
+    return true;
+}
+
+void rotation_invalidate(void)
+{
+    while (lru_head) {
+        frame_free(lru_head);
+    }
+}
+
+bool rotation_draw(cairo_t *const cr, int xshape_mask)
+{
+    if (shown < 0 || !quotes[shown]) {
+        return false;
+    }
+
+    // XShape passes are cheap and differ per pass, they are not cached
+    if (xshape_mask != 0) {
+        draw_symbol(cr, shown, xshape_mask);
+        return true;
+    }
+
+    rotation_frame_t *f = frames[shown];
+    if (f && f->version == quotes[shown]->version && f->scale == options.scale) {
+        lru_unlink(f);
+        lru_push_front(f);
+    } else {
+        f = frame_render(shown);
+        if (!f) {
+            return false;
+        }
+    }
+
+    cairo_save(cr);
+    cairo_set_operator(cr, CAIRO_OPERATOR_SOURCE);
+    cairo_set_source_surface(cr, f->surface, 0, 0);
+    cairo_paint(cr);
+    cairo_restore(cr);
+    return true;
+}
+
+#endif
@@ -0,0 +1,61 @@
+#ifndef INCLUDE_ROTATION_H
+#define INCLUDE_ROTATION_H
+
+#include <stdbool.h>
+#include <cairo/cairo.h>
+#include "color.h"
+
+/**
+ * Stores the latest overlay content of a symbol.
+ *
+ * Bumps the content version of the symbol if anything changed, which makes
+ * its cached frame stale.
+ *
+ * @param symbol   The symbol name.
+ * @param title    The title line.
+ * @param subtitle The subtitle line(s).
+ * @param color    The text color.
+ *
+ * @returns true if the symbol is the one currently shown.
+ */
+bool rotation_update(const char *const symbol, const char *const title,
+                     const char *const subtitle, rgba_color color);
+
+/**
+ * Switches to the next symbol that has content.
+ *
+ * @returns true if the shown symbol changed.
+ */
+bool rotation_next(void);
+
+/**
+ * Removes a symbol from the rotation together with its cached frame.
+ *
+ * @param symbol The symbol name.
+ *
+ * @returns true if it was the symbol currently shown.
+ */
+bool rotation_remove(const char *const symbol);
+
+/**
+ * Drops all cached frames, e.g. after the font or the overlay size changed.
+ */
+void rotation_invalidate(void);
+
+/**
+ * Draws the overlay of the shown symbol.
+ *
+ * Fully rendered overlays are kept in an LRU of offscreen surfaces keyed by
+ * symbol, content version and scale, bounded by `options.frame_cache_kb'.
+ * Showing a symbol whose content did not change is a single blit; only a
+ * miss runs draw_text() with the symbol's content. XShape passes are drawn
+ * directly.
+ *
+ * @param cr          The cairo context to draw into.
+ * @param xshape_mask The XShape pass, as for draw_text().
+ *
+ * @returns false if there is nothing to show yet.
+ */
+bool rotation_draw(cairo_t *const cr, int xshape_mask);
+
+#endif
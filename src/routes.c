@@ -0,0 +1,184 @@
+#ifdef CAIRO
+
+#include "routes.h"
+#include "animation.h"
+#include "cairo_draw_text.h"
+#include "sparkline.h"
+#include "symbols.h"
+#include "options.h"
+#include "log.h"
+#include <fnmatch.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+    char *output;
+    char **symbols;
+    int symbol_count;
+
+    // the newest quote of its symbols
+    int slot;
+    char symbol[SYMBOL_NAME_LEN];
+    char title[64];
+    char subtitle[64];
+    rgba_color color;
+    double time;
+    bool quoted;
+    bool dirty;
+} route_t;
+
+static route_t *routes = NULL;
+static int route_count = 0;
+
+// the routes of each slot as a bit mask, matched again once `version'
+// moved on
+static uint32_t slot_routes[SYMBOLS_MAX];
+static unsigned slot_versions[SYMBOLS_MAX];
+static unsigned version = 1;
+
+static void routes_free(route_t *table, int count)
+{
+    for (int i = 0; i < count; i++) {
+        free(table[i].output);
+        for (int j = 0; j < table[i].symbol_count; j++) {
+            free(table[i].symbols[j]);
+        }
+        free(table[i].symbols);
+    }
+    free(table);
+}
+
+int routes_set(const route_spec_t *const specs, int count)
+{
+    if (count > ROUTES_MAX) {
+        __error__("Only the first %d outputs get their own symbols\n", ROUTES_MAX);
+        count = ROUTES_MAX;
+    }
+
+    route_t *table = calloc(count > 0 ? count : 1, sizeof(route_t));
+    bool failed = table == NULL;
+    for (int i = 0; i < count && !failed; i++) {
+        route_t *r = &table[i];
+        r->output = strdup(specs[i].output);
+        r->symbols = calloc(specs[i].symbol_count > 0 ? specs[i].symbol_count : 1, sizeof(char *));
+        failed = !r->output || !r->symbols;
+        for (int j = 0; j < specs[i].symbol_count && !failed; j++) {
+            r->symbols[r->symbol_count] = strdup(specs[i].symbols[j]);
+            failed = r->symbols[r->symbol_count++] == NULL;
+        }
+
+        // an output that stays keeps showing its quote
+        for (int j = 0; j < route_count && !failed; j++) {
+            if (strcmp(routes[j].output, r->output) == 0 && routes[j].quoted) {
+                r->slot = routes[j].slot;
+                memcpy(r->symbol, routes[j].symbol, sizeof(r->symbol));
+                memcpy(r->title, routes[j].title, sizeof(r->title));
+                memcpy(r->subtitle, routes[j].subtitle, sizeof(r->subtitle));
+                r->color = routes[j].color;
+                r->time = routes[j].time;
+                r->quoted = true;
+            }
+        }
+    }
+    if (failed) {
+        __error__("Cannot allocate the symbols of the outputs\n");
+        routes_free(table, table ? count : 0);
+        return -1;
+    }
+
+    routes_free(routes, route_count);
+    routes = table;
+    route_count = count;
+    version++;
+    return 0;
+}
+
+int routes_find(const char *const output)
+{
+    for (int i = 0; i < route_count; i++) {
+        if (strcmp(routes[i].output, output) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static uint32_t slot_mask(int slot, const char *const symbol)
+{
+    if (slot_versions[slot] != version) {
+        uint32_t mask = 0;
+        for (int i = 0; i < route_count; i++) {
+            for (int j = 0; j < routes[i].symbol_count; j++) {
+                if (fnmatch(routes[i].symbols[j], symbol, 0) == 0) {
+                    mask |= 1u << i;
+                    break;
+                }
+            }
+        }
+        slot_routes[slot] = mask;
+        slot_versions[slot] = version;
+    }
+    return slot_routes[slot];
+}
+
+bool routes_wanted(int slot, const char *const symbol)
+{
+    return route_count > 0 && slot >= 0 && slot_mask(slot, symbol) != 0;
+}
+
+void routes_quote(int slot, const stock_data_t *const quote, rgba_color color)
+{
+    uint32_t mask = routes_wanted(slot, quote->symbol) ? slot_mask(slot, quote->symbol) : 0;
+    for (int i = 0; mask; i++, mask >>= 1) {
+        route_t *r = &routes[i];
+        if (!(mask & 1) || (r->quoted && quote->time < r->time)) {
+            continue;
+        }
+        r->slot = slot;
+        memcpy(r->symbol, quote->symbol, sizeof(r->symbol));
+        memcpy(r->title, quote->title, sizeof(r->title));
+        memcpy(r->subtitle, quote->subtitle, sizeof(r->subtitle));
+        r->color = color;
+        r->time = quote->time;
+        r->quoted = true;
+        r->dirty = true;
+    }
+}
+
+bool routes_take(int route)
+{
+    if (route < 0 || route >= route_count || !routes[route].dirty) {
+        return false;
+    }
+    routes[route].dirty = false;
+    return true;
+}
+
+bool routes_animating(int route)
+{
+    return route >= 0 && route < route_count && routes[route].quoted && animation_active(routes[route].slot);
+}
+
+void routes_draw(cairo_t *const cr, int route, int xshape_mask)
+{
+    if (route < 0 || route >= route_count || !routes[route].quoted) {
+        draw_text(cr, xshape_mask);
+        return;
+    }
+
+    route_t *r = &routes[route];
+    Options orig = options;
+    const char *selected = sparkline_selected();
+    options.title = r->title;
+    options.subtitle = r->subtitle;
+    options.text_color = animation_color(r->slot, r->color);
+    sparkline_select(r->symbol);
+
+    draw_text(cr, xshape_mask);
+
+    options = orig;
+    sparkline_select(selected);
+}
+
+#endif
@@ -0,0 +1,89 @@
+#ifndef INCLUDE_ROUTES_H
+#define INCLUDE_ROUTES_H
+
+#include <stdbool.h>
+#include <cairo/cairo.h>
+#include "color.h"
+#include "quote.h"
+
+/**
+ * Maximum number of outputs with their own symbols.
+ */
+#define ROUTES_MAX 32
+
+/**
+ * Struct representing one entry of the routing table.
+ */
+typedef struct route_spec_t {
+    // the output, e.g. a RandR monitor name as listed by xrandr --listmonitors
+    const char *output;
+    // the symbols it shows, patterns match like Redis' PSUBSCRIBE
+    const char *const *symbols;
+    int symbol_count;
+} route_spec_t;
+
+/**
+ * Replaces the routing table.
+ *
+ * An output in the table shows the newest quote of its own symbols instead
+ * of the newest quote of all. Outputs keep what they show across a
+ * replacement if they stay in the table.
+ *
+ * @param routes The entries, copied.
+ * @param count  The number of entries, at most ROUTES_MAX.
+ *
+ * @returns 0 on success, -1 if the table cannot be allocated, in which
+ *          case the previous one stays.
+ */
+int routes_set(const route_spec_t *const routes, int count);
+
+/**
+ * @param output The output name.
+ *
+ * @returns The route of the output, or -1 if it shows all symbols.
+ */
+int routes_find(const char *const output);
+
+/**
+ * @param slot   The symbol slot, see symbol_slot().
+ * @param symbol The symbol name.
+ *
+ * @returns Whether any output is routed the symbol. The patterns are only
+ *          matched the first time a symbol is asked for after the table
+ *          changed.
+ */
+bool routes_wanted(int slot, const char *const symbol);
+
+/**
+ * Shows a formatted quote on the outputs routed its symbol, where it is
+ * the newest of their symbols, and marks them dirty. Other outputs are
+ * left alone.
+ *
+ * @param slot  The symbol slot.
+ * @param quote The quote, with title and subtitle formatted.
+ * @param color The text color.
+ */
+void routes_quote(int slot, const stock_data_t *const quote, rgba_color color);
+
+/**
+ * @returns Whether the route got a quote since it was last asked, and
+ *          clears that.
+ */
+bool routes_take(int route);
+
+/**
+ * @returns Whether the symbol a route shows is animating.
+ */
+bool routes_animating(int route);
+
+/**
+ * Draws what a route shows, like draw_text() draws the global text. A
+ * route without quotes yet shows the global text.
+ *
+ * @param cr          The cairo context to draw into.
+ * @param route       The route.
+ * @param xshape_mask The XShape pass, as for draw_text().
+ */
+void routes_draw(cairo_t *const cr, int route, int xshape_mask);
+
+#endif
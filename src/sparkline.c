@@ -0,0 +1,261 @@
+#ifdef CAIRO
+
+#include "sparkline.h"
+#include "symbols.h"
+#include "options.h"
+#include "log.h"
+#include <cairo/cairo.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+// one downsampled time bucket
+typedef struct {
+    float lo, hi, last;
+    bool valid;
+} sparkline_point_t;
+
+typedef struct {
+    // ring of buckets, `head' is the newest one
+    sparkline_point_t points[SPARKLINE_POINTS];
+    int head;
+    long bucket;
+
+    // offscreen mask holding the rendered history
+    cairo_surface_t *surface;
+    cairo_t *cr;
+    float scale;
+    double range_lo, range_hi;
+
+    // pending work for the next sparkline_draw()
+    bool dirty;         // full re-render
+    int shift;          // columns to scroll left
+    bool newest;        // newest column changed
+} sparkline_t;
+
+static sparkline_t *sparklines[SYMBOLS_MAX];
+static int selected = -1;
+
+static long bucket_seconds(void)
+{
+    long secs = options.sparkline_hours * 3600 / SPARKLINE_POINTS;
+    return secs > 0 ? secs : 1;
+}
+
+// oldest column is 0, newest is SPARKLINE_POINTS - 1
+static sparkline_point_t *column_point(sparkline_t *s, int column)
+{
+    return &s->points[(s->head + 1 + column) % SPARKLINE_POINTS];
+}
+
+void sparkline_push(const char *const symbol, double time, double value)
+{
+    if (options.sparkline_hours <= 0) {
+        return;
+    }
+
+    int slot = symbol_slot(symbol);
+    if (slot < 0) {
+        return;
+    }
+
+    sparkline_t *s = sparklines[slot];
+    if (!s) {
+        s = sparklines[slot] = calloc(1, sizeof(sparkline_t));
+        if (!s) {
+            __error__("Cannot allocate sparkline for %s\n", symbol);
+            return;
+        }
+        s->bucket = (long)(time / bucket_seconds());
+        s->dirty = true;
+    }
+
+    long bucket = (long)(time / bucket_seconds());
+    if (bucket < s->bucket) {
+        __debug__("Ignoring out-of-order sparkline tick for %s\n", symbol);
+        return;
+    }
+
+    if (bucket > s->bucket) {
+        long n = bucket - s->bucket;
+        if (n >= SPARKLINE_POINTS) {
+            memset(s->points, 0, sizeof(s->points));
+            s->dirty = true;
+        } else {
+            for (long i = 0; i < n; i++) {
+                s->head = (s->head + 1) % SPARKLINE_POINTS;
+                s->points[s->head].valid = false;
+            }
+            s->shift += n;
+            if (s->shift >= SPARKLINE_POINTS) {
+                s->dirty = true;
+            }
+        }
+        s->bucket = bucket;
+    }
+
+    sparkline_point_t *p = &s->points[s->head];
+    if (!p->valid) {
+        p->lo = p->hi = value;
+        p->valid = true;
+    } else if (value < p->lo) {
+        p->lo = value;
+    } else if (value > p->hi) {
+        p->hi = value;
+    }
+    p->last = value;
+    s->newest = true;
+
+    // the vertical scale only changes on a full re-render
+    if (value < s->range_lo || value > s->range_hi) {
+        s->dirty = true;
+    }
+}
+
+void sparkline_select(const char *const symbol)
+{
+    selected = symbol ? symbol_find(symbol) : -1;
+}
+
+const char *sparkline_selected(void)
+{
+    return selected < 0 ? NULL : symbol_name(selected);
+}
+
+static int column_width(void)
+{
+    int width = options.scale + 0.5;
+    return width > 0 ? width : 1;
+}
+
+static double value_y(sparkline_t *s, double value, int height)
+{
+    return (s->range_hi - value) / (s->range_hi - s->range_lo) * (height - 1);
+}
+
+// redraws one column; spans from the previous close so columns join up
+static void draw_column(sparkline_t *s, int column)
+{
+    int width = column_width();
+    int height = SPARKLINE_HEIGHT * s->scale;
+
+    cairo_set_operator(s->cr, CAIRO_OPERATOR_CLEAR);
+    cairo_rectangle(s->cr, column * width, 0, width, height);
+    cairo_fill(s->cr);
+
+    sparkline_point_t *p = column_point(s, column);
+    if (!p->valid) {
+        return;
+    }
+
+    double lo = p->lo, hi = p->hi;
+    if (column > 0) {
+        sparkline_point_t *prev = column_point(s, column - 1);
+        if (prev->valid) {
+            lo = (prev->last < lo) ? prev->last : lo;
+            hi = (prev->last > hi) ? prev->last : hi;
+        }
+    }
+
+    double top = value_y(s, hi, height);
+    double bottom = value_y(s, lo, height);
+    cairo_set_operator(s->cr, CAIRO_OPERATOR_SOURCE);
+    cairo_rectangle(s->cr, column * width, top, width,
+                    (bottom - top > width) ? bottom - top : width);
+    cairo_fill(s->cr);
+}
+
+// moves the mask `columns' to the left in place and clears the freed area
+static void scroll_surface(sparkline_t *s, int columns)
+{
+    cairo_surface_flush(s->surface);
+
+    unsigned char *data = cairo_image_surface_get_data(s->surface);
+    int stride = cairo_image_surface_get_stride(s->surface);
+    int width = cairo_image_surface_get_width(s->surface);
+    int height = cairo_image_surface_get_height(s->surface);
+    int dx = columns * column_width();
+
+    if (dx > width) {
+        dx = width;
+    }
+    for (int row = 0; row < height; row++) {
+        unsigned char *line = data + row * stride;
+        memmove(line, line + dx, width - dx);
+        memset(line + width - dx, 0, dx);
+    }
+
+    cairo_surface_mark_dirty(s->surface);
+}
+
+static void render_full(sparkline_t *s)
+{
+    double lo = 0, hi = 0;
+    bool any = false;
+    for (int i = 0; i < SPARKLINE_POINTS; i++) {
+        sparkline_point_t *p = &s->points[i];
+        if (!p->valid) {
+            continue;
+        }
+        if (!any || p->lo < lo) lo = p->lo;
+        if (!any || p->hi > hi) hi = p->hi;
+        any = true;
+    }
+
+    // leave headroom so that small moves keep the incremental path
+    double pad = (hi - lo) * 0.1;
+    if (pad <= 0) {
+        pad = (hi > 0 ? hi : -hi) * 0.001 + 0.01;
+    }
+    s->range_lo = lo - pad;
+    s->range_hi = hi + pad;
+
+    __debug__("Full sparkline render, range %f to %f\n", s->range_lo, s->range_hi);
+    for (int column = 0; column < SPARKLINE_POINTS; column++) {
+        draw_column(s, column);
+    }
+}
+
+void sparkline_draw(cairo_t *const cr, double x, double y)
+{
+    if (selected < 0 || !sparklines[selected]) {
+        return;
+    }
+    sparkline_t *s = sparklines[selected];
+
+    if (!s->surface || s->scale != options.scale) {
+        if (s->surface) {
+            cairo_destroy(s->cr);
+            cairo_surface_destroy(s->surface);
+        }
+        s->scale = options.scale;
+        s->surface = cairo_image_surface_create(CAIRO_FORMAT_A8,
+                                                SPARKLINE_POINTS * column_width(),
+                                                SPARKLINE_HEIGHT * s->scale);
+        s->cr = cairo_create(s->surface);
+        cairo_set_antialias(s->cr, CAIRO_ANTIALIAS_NONE);
+        cairo_set_source_rgba(s->cr, 0, 0, 0, 1);
+        s->dirty = true;
+    }
+
+    if (s->dirty) {
+        render_full(s);
+    } else {
+        if (s->shift > 0) {
+            scroll_surface(s, s->shift);
+            // the previous newest column may have been partial
+            draw_column(s, SPARKLINE_POINTS - 1 - s->shift);
+        }
+        if (s->newest || s->shift > 0) {
+            draw_column(s, SPARKLINE_POINTS - 1);
+        }
+    }
+    s->dirty = false;
+    s->shift = 0;
+    s->newest = false;
+
+    cairo_surface_flush(s->surface);
+    cairo_mask_surface(cr, s->surface, x, y);
+}
+
+#endif
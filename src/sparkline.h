@@ -0,0 +1,54 @@
+#ifndef INCLUDE_SPARKLINE_H
+#define INCLUDE_SPARKLINE_H
+
+#include <cairo/cairo.h>
+
+/**
+ * Number of downsampled points (time buckets) kept per symbol. Each point is
+ * rendered as one column of the sparkline.
+ */
+#define SPARKLINE_POINTS 150
+
+/**
+ * Height of the sparkline before scaling, in pixels.
+ */
+#define SPARKLINE_HEIGHT 24
+
+/**
+ * Records a tick for the given symbol.
+ *
+ * The history window is `options.sparkline_hours' long and split into
+ * SPARKLINE_POINTS buckets; ticks falling into the same bucket only update
+ * its low/high/last values. Does nothing while sparklines are disabled.
+ *
+ * @param symbol The symbol name.
+ * @param time   The tick time in seconds since the epoch.
+ * @param value  The price, usually the `close' field.
+ */
+void sparkline_push(const char *const symbol, double time, double value);
+
+/**
+ * Selects the symbol whose sparkline is drawn by sparkline_draw(), none if
+ * NULL.
+ */
+void sparkline_select(const char *const symbol);
+
+/**
+ * @returns The selected symbol, or NULL.
+ */
+const char *sparkline_selected(void);
+
+/**
+ * Draws the sparkline of the selected symbol with the current source color.
+ *
+ * The history is kept rendered in an offscreen mask. When a new bucket
+ * arrives the mask is scrolled left in place and only the newest column is
+ * drawn, so the cost per tick does not depend on SPARKLINE_POINTS.
+ *
+ * @param cr The cairo context to draw into.
+ * @param x  Left edge of the sparkline.
+ * @param y  Top edge of the sparkline.
+ */
+void sparkline_draw(cairo_t *const cr, double x, double y);
+
+#endif
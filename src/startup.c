@@ -0,0 +1,35 @@
+#include <stdio.h>
+#include <time.h>
+
+#include "options.h"
+#include "startup.h"
+
+static double started = 0;
+// the previous mark of each thread
+static _Thread_local double previous = 0;
+
+static double monotonic_ms(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+void startup_trace_begin(void) {
+  started = monotonic_ms();
+  previous = started;
+}
+
+void startup_trace(const char *const phase) {
+  if (!options.startup_trace) {
+    return;
+  }
+
+  double now = monotonic_ms();
+  if (previous == 0) {
+    // first mark of a thread started later, its phase ran since startup
+    previous = started;
+  }
+  // straight to stderr, the timeline is wanted even with -q
+  fprintf(stderr, "startup %9.3f ms  %+9.3f ms  %s\n", now - started, now - previous, phase);
+  previous = now;
+}
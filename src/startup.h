@@ -0,0 +1,20 @@
+#ifndef INCLUDE_STARTUP_H
+#define INCLUDE_STARTUP_H
+
+/**
+ * Starts the clock of the startup timeline, first thing in main().
+ */
+void startup_trace_begin(void);
+
+/**
+ * Marks the end of a startup phase if --startup-trace was given.
+ *
+ * Prints the time since startup_trace_begin() and since the previous mark
+ * of the calling thread, so phases that run concurrently on different
+ * threads each show their own duration.
+ *
+ * @param phase What just completed, e.g. "display opened".
+ */
+void startup_trace(const char *const phase);
+
+#endif
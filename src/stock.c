@@ -0,0 +1,299 @@
+#ifdef CAIRO
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "stock.h"
+#include "log.h"
+#include "options.h"
+#include "sparkline.h"
+#include "symbols.h"
+#include "bars.h"
+#include "analytics.h"
+#include "alerts.h"
+#include "animation.h"
+#include "ticker.h"
+#include "rotation.h"
+#include "routes.h"
+#include "control.h"
+#include "board.h"
+
+stock_data_t current_stock_data = {0};
+time_t most_recent = 0;
+int needs_redraw = 0;
+// cumulative volume last seen per symbol, to turn updates into trade sizes
+static long last_volume[SYMBOLS_MAX] = {0};
+// time of the last quote per symbol
+static time_t last_tick[SYMBOLS_MAX] = {0};
+// decimals shown per symbol, the most published so far but at least 2
+static signed char decimals[SYMBOLS_MAX] = {0};
+// last price per symbol, ticks flash by the way it moved
+static double last_price[SYMBOLS_MAX] = {0};
+// the symbol on the overlays that show the most recent quote, and its
+// color without animation
+static int shown_slot = -1;
+static rgba_color shown_color;
+
+// Flags a quote newer than anything seen so far as the one to show
+static void mark_updated(stock_data_t *stock_data) {
+    if (stock_data->time > most_recent) {
+        stock_data->updated = 1;
+        most_recent = stock_data->time;
+        __info__("Seeing updated data for %s at %s\n", stock_data->symbol, stock_data->fmttime);
+    } else {
+        stock_data->updated = 0;
+    }
+}
+
+rgba_color assign_rgb_colors(double chg, float cols[9][3]) {
+    int p = chg / 0.250;        // truncating division used on purpose here
+    //p = (p > 8) ? 8 : p; 	// so that we don't need fmin() and hence -lm linking */
+    p = (p > 7) ? 7 : p; 	// the extreme one is too dark on the dark terminal
+    return rgba_color_new(cols[p][0], cols[p][1], cols[p][2], 0.6);
+}
+
+// Color for a percentage change
+rgba_color change_color(double chg) {
+    // these are from ColorBrewer and are the red and green four valued multi-hue
+    // values, divided by 255 to fit the [0, 1) range here
+    // see
+    //   RColorBrewer::display.brewer.pal(9, "Reds")
+    // use
+    //   M <- col2rgb(RColorBrewer::brewer.pal(9, "Reds"))/255
+    //   for (i in 1:9) cat("{ ", paste(sprintf("%.8f",M[,i]), collapse=", "), "},\n")
+    float reds[9][3] = {
+        {  1.00000000, 0.96078431, 0.94117647 },
+        {  0.99607843, 0.87843137, 0.82352941 },
+        {  0.98823529, 0.73333333, 0.63137255 },
+        {  0.98823529, 0.57254902, 0.44705882 },
+        {  0.98431373, 0.41568627, 0.29019608 },
+        {  0.93725490, 0.23137255, 0.17254902 },
+        {  0.79607843, 0.09411765, 0.11372549 },
+        {  0.64705882, 0.05882353, 0.08235294 },
+        {  0.40392157, 0.00000000, 0.05098039 }
+    };
+    // see
+    //   RColorBrewer::display.brewer.pal(9, "Greens")
+    // use
+    //   M <- col2rgb(RColorBrewer::brewer.pal(9, "Greens"))/255
+    //   for (i in 1:9) cat("{ ", paste(sprintf("%.8f",M[,i]), collapse=", "), "},\n")
+    float greens[9][3] = {
+        {  0.96862745, 0.98823529, 0.96078431 },
+        {  0.89803922, 0.96078431, 0.87843137 },
+        {  0.78039216, 0.91372549, 0.75294118 },
+        {  0.63137255, 0.85098039, 0.60784314 },
+        {  0.45490196, 0.76862745, 0.46274510 },
+        {  0.25490196, 0.67058824, 0.36470588 },
+        {  0.13725490, 0.54509804, 0.27058824 },
+        {  0.00000000, 0.42745098, 0.17254902 },
+        {  0.00000000, 0.26666667, 0.10588235 }
+    };
+    if (chg < 0)
+        return assign_rgb_colors(-chg, reds);
+    else
+        return assign_rgb_colors(chg, greens);
+}
+
+// Color for a quote: by its change, inverted while an alert holds
+static rgba_color quote_color(const stock_data_t *data, double chg) {
+    rgba_color color = change_color(chg);
+    if (alerts_active(symbol_find(data->symbol), data->time)) {
+        color = rgba_color_new(1 - color.r, 1 - color.g, 1 - color.b, color.a);
+    }
+    return color;
+}
+
+// Decimals to show for the prices of a symbol
+static int price_decimals(const stock_data_t *data) {
+    int slot = symbol_find(data->symbol);
+    int scale = data->close.scale < 2 ? 2 : data->close.scale;
+    if (slot < 0) {
+        return scale;
+    }
+    if (scale > decimals[slot]) {
+        decimals[slot] = scale;
+    }
+    return decimals[slot];
+}
+
+// Change to display for a quote, from the feed or from the selected bar
+void stock_change(const stock_data_t *data, int scale, price_t *change, price_t *percent_change) {
+    *change = data->change;
+    *percent_change = data->percent_change;
+    if (options.bar_period >= 0) {
+        const bar_t *bar = bars_get(symbol_find(data->symbol), options.bar_period, 0);
+        if (bar) {
+            *change = price_from_double(bar_change(bar), scale);
+            *percent_change = price_from_double(bar_percent_change(bar), 3);
+        }
+    }
+}
+
+// What the color ramp is keyed by: the percent change, or with
+// --zscore-color how unusual the move of the current minute is, two
+// standard deviations matching one percent
+static double color_key(const stock_data_t *data, double percent_change) {
+    analytics_t stats;
+    if (options.zscore_color && analytics_get(symbol_find(data->symbol), &stats) && stats.minutes > 1) {
+        return stats.zscore / 2;
+    }
+    return percent_change;
+}
+
+// Function to format stock data and time into its title and subtitle,
+// returns the value the color is based on
+double format_stock_data(stock_data_t *data) {
+    price_t change, percent_change;
+    int scale = price_decimals(data);
+    stock_change(data, scale, &change, &percent_change);
+    format_quote(data, change, percent_change, scale);
+    analytics_t stats;
+    if (options.analytics && analytics_get(symbol_find(data->symbol), &stats)) {
+        format_quote_analytics(data, &stats, scale);
+    }
+    return color_key(data, price_to_double(percent_change));
+}
+
+// Function to format stock data and time into activate-linux fields: for
+// the outputs routed its symbol, and for the others if it is the most
+// recent quote
+void draw_stock_data(int slot) {
+    bool routed = routes_wanted(slot, current_stock_data.symbol);
+    if (current_stock_data.updated != 1 && !routed) {
+        __info__("Ignoring quote %s at %s\n", current_stock_data.symbol, current_stock_data.fmttime);
+        return;
+    }
+
+    double percent_change = format_stock_data(&current_stock_data);
+    rgba_color color = quote_color(&current_stock_data, percent_change);
+    if (routed) {
+        routes_quote(slot, &current_stock_data, color);
+    }
+    if (current_stock_data.updated != 1) {
+        return;
+    }
+
+    __info__("Stock data updated for %s to %s\n", current_stock_data.symbol, current_stock_data.fmttime);
+    options.title = current_stock_data.title;
+    options.subtitle = current_stock_data.subtitle;
+    sparkline_select(current_stock_data.symbol);
+    shown_slot = slot;
+    shown_color = color;
+    options.text_color = animation_color(slot, color);
+    if (needs_redraw) {
+        control_stats.conflated++;
+    }
+    needs_redraw = 1;
+}
+
+// Function to refresh the rotation entry of the current symbol
+void update_rotation_data() {
+    double percent_change = format_stock_data(&current_stock_data);
+    if (rotation_update(current_stock_data.symbol, current_stock_data.title,
+                        current_stock_data.subtitle, quote_color(&current_stock_data, percent_change))) {
+        if (needs_redraw) {
+            control_stats.conflated++;
+        }
+        needs_redraw = 1;
+    }
+}
+
+// Function to refresh the ticker tape entry of the current symbol
+void update_ticker_data() {
+    price_t change, percent_change;
+    char text[64];
+    int scale = price_decimals(&current_stock_data);
+    stock_change(&current_stock_data, scale, &change, &percent_change);
+    format_quote_ticker(text, sizeof(text), &current_stock_data, change, percent_change, scale);
+    if (ticker_update(current_stock_data.symbol, text,
+                      quote_color(&current_stock_data,
+                                  color_key(&current_stock_data, price_to_double(percent_change))))) {
+        control_stats.conflated++;
+    }
+}
+
+// Function to update bars, sparkline and display with current_stock_data
+static void apply_stock_data() {
+    // the feed carries cumulative volume, a drop means a new session
+    int slot = symbol_slot(current_stock_data.symbol);
+    if (slot >= 0) {
+        long traded = current_stock_data.volume - last_volume[slot];
+        if (traded < 0) {
+            traded = current_stock_data.volume;
+        }
+        last_volume[slot] = current_stock_data.volume;
+        last_tick[slot] = current_stock_data.time;
+        bars_tick(slot, current_stock_data.time, price_to_double(current_stock_data.close), traded);
+        const bar_t *session = bars_get(slot, BAR_SESSION, 0);
+        analytics_tick(slot, current_stock_data.time, session ? session->time : 0,
+                       price_to_double(current_stock_data.close), traded);
+        alerts_tick(slot, current_stock_data.symbol, current_stock_data.time,
+                    price_to_double(current_stock_data.close), price_to_double(current_stock_data.percent_change));
+
+        double price = price_to_double(current_stock_data.close);
+        if (options.display_mode == DISPLAY_STATIC && last_price[slot] != 0 && price != last_price[slot]) {
+            animation_flash(slot, price > last_price[slot]);
+        }
+        last_price[slot] = price;
+    }
+    sparkline_push(current_stock_data.symbol, current_stock_data.time,
+                   price_to_double(current_stock_data.close));
+    if (options.display_mode == DISPLAY_TICKER) {
+        // every symbol stays on the tape, not just the most recent
+        update_ticker_data();
+    } else if (options.display_mode == DISPLAY_ROTATE) {
+        update_rotation_data();
+    } else {
+        draw_stock_data(slot);
+    }
+}
+
+// Function to handle a quote published on a symbol channel
+void stock_message(const char *const channel, const char *const message) {
+    // Parse and update stock data
+    strncpy(current_stock_data.symbol, channel,
+            sizeof(current_stock_data.symbol) - 1);
+    current_stock_data.symbol[sizeof(current_stock_data.symbol) - 1] = '\0';
+
+    if (parse_stock_data(message, &current_stock_data) != 0) {
+        printf("Error parsing stock data: %s\n", message);
+        return;
+    }
+    mark_updated(&current_stock_data);
+
+    if (options.board_mode == BOARD_PUBLISH) {
+        board_publish(&current_stock_data);
+    }
+    apply_stock_data();
+}
+
+// Function to handle a quote decoded by another process
+void stock_quote(const stock_data_t *const quote) {
+    current_stock_data = *quote;
+    mark_updated(&current_stock_data);
+    apply_stock_data();
+}
+
+bool stock_animate(void) {
+    if (shown_slot < 0 || !animation_active(shown_slot)) {
+        return false;
+    }
+    options.text_color = animation_color(shown_slot, shown_color);
+    return true;
+}
+
+time_t stock_last_tick(const char *const symbol) {
+    int slot = symbol_find(symbol);
+    return slot < 0 ? 0 : last_tick[slot];
+}
+
+void stock_forget(const char *const symbol) {
+    ticker_remove(symbol);
+    if (rotation_remove(symbol)) {
+        needs_redraw = 1;
+    }
+}
+
+#endif
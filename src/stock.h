@@ -0,0 +1,76 @@
+#ifndef INCLUDE_STOCK_H
+#define INCLUDE_STOCK_H
+
+#include <stdbool.h>
+#include <time.h>
+#include "color.h"
+#include "quote.h"
+
+extern stock_data_t current_stock_data;
+extern time_t most_recent;
+
+/**
+ * Set when a message changed what the overlay shows, cleared by the
+ * backend once it redrew.
+ */
+extern int needs_redraw;
+
+/**
+ * @param chg  The size of a percentage change, not negative.
+ * @param cols A ColorBrewer ramp of nine shades, lightest first.
+ *
+ * @returns The shade of the ramp for the change, one per quarter percent.
+ */
+rgba_color assign_rgb_colors(double chg, float cols[9][3]);
+
+/**
+ * @returns The ColorBrewer red or green shade for a percentage change.
+ */
+rgba_color change_color(double chg);
+
+/**
+ * Formats `current_stock_data' for the static display: shows it if it is
+ * the most recent quote and passes it to the outputs routed its symbol.
+ *
+ * @param slot The symbol slot of the quote, see symbol_slot().
+ */
+void draw_stock_data(int slot);
+
+/**
+ * Handles a quote published on a channel: updates bars and sparkline and
+ * the overlay, ticker tape or rotation entry of the symbol.
+ *
+ * @param channel The channel, i.e. the symbol.
+ * @param message The quote record.
+ */
+void stock_message(const char *const channel, const char *const message);
+
+/**
+ * Handles a quote decoded elsewhere, e.g. read from the quote board.
+ *
+ * @param quote The quote; only the feed fields are used.
+ */
+void stock_quote(const stock_data_t *const quote);
+
+/**
+ * Sets the text color to the current frame of the flash of the symbol the
+ * static display shows.
+ *
+ * @returns Whether that symbol is animating.
+ */
+bool stock_animate(void);
+
+/**
+ * @returns The time of the last quote of a symbol, or 0 if none arrived.
+ */
+time_t stock_last_tick(const char *const symbol);
+
+/**
+ * Drops a symbol from the ticker tape and the rotation after it was
+ * unsubscribed. Its bars and sparkline history are kept.
+ *
+ * @param symbol The symbol name.
+ */
+void stock_forget(const char *const symbol);
+
+#endif
@@ -0,0 +1,68 @@
+#include "symbols.h"
+#include "log.h"
+
+#include <stdint.h>
+#include <string.h>
+
+// open addressing table, kept at most half full
+#define SYMBOLS_BUCKETS (2 * SYMBOLS_MAX)
+
+static char names[SYMBOLS_MAX][SYMBOL_NAME_LEN];
+// slot + 1 for each bucket, 0 marks an empty bucket
+static int16_t buckets[SYMBOLS_BUCKETS];
+static int count = 0;
+
+// FNV-1a, good enough for short ticker names
+static uint32_t symbol_hash(const char *name) {
+  uint32_t h = 2166136261u;
+  for (int i = 0; name[i] && i < SYMBOL_NAME_LEN - 1; i++) {
+    h ^= (unsigned char)name[i];
+    h *= 16777619u;
+  }
+  return h;
+}
+
+// returns bucket holding `name', or the empty bucket where it would go
+static int symbol_bucket(const char *const name) {
+  uint32_t b = symbol_hash(name) % SYMBOLS_BUCKETS;
+  while (buckets[b] != 0) {
+    if (strncmp(names[buckets[b] - 1], name, SYMBOL_NAME_LEN - 1) == 0) {
+      break;
+    }
+    b = (b + 1) % SYMBOLS_BUCKETS;
+  }
+  return b;
+}
+
+int symbol_find(const char *const name) {
+  return buckets[symbol_bucket(name)] - 1;
+}
+
+int symbol_slot(const char *const name) {
+  int b = symbol_bucket(name);
+  if (buckets[b] != 0) {
+    return buckets[b] - 1;
+  }
+
+  if (count == SYMBOLS_MAX) {
+    __warn__("Symbol table full, ignoring %s\n", name);
+    return -1;
+  }
+
+  strncpy(names[count], name, SYMBOL_NAME_LEN - 1);
+  names[count][SYMBOL_NAME_LEN - 1] = '\0';
+  buckets[b] = ++count;
+  __debug__("Registered symbol %s in slot %d\n", names[count - 1], count - 1);
+  return count - 1;
+}
+
+const char *symbol_name(int slot) {
+  if (slot < 0 || slot >= count) {
+    return NULL;
+  }
+  return names[slot];
+}
+
+int symbol_count(void) {
+  return count;
+}
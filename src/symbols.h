@@ -0,0 +1,46 @@
+#ifndef INCLUDE_SYMBOLS_H
+#define INCLUDE_SYMBOLS_H
+
+/**
+ * Maximum number of distinct symbols tracked at the same time.
+ */
+#define SYMBOLS_MAX 4096
+
+/**
+ * Maximum length of a symbol name, including the terminating zero.
+ * Matches the size of the `symbol` field of the Redis stock record.
+ */
+#define SYMBOL_NAME_LEN 16
+
+/**
+ * Looks up the slot of a symbol, registering it on first sight.
+ *
+ * Slots are small dense integers which per-symbol modules use to index
+ * their own fixed-size tables instead of comparing names on every tick.
+ *
+ * @param name The symbol (Redis channel) name.
+ *
+ * @returns The slot in [0, SYMBOLS_MAX), or -1 if the table is full.
+ */
+int symbol_slot(const char *const name);
+
+/**
+ * Looks up the slot of an already registered symbol.
+ *
+ * @param name The symbol name.
+ *
+ * @returns The slot, or -1 if the symbol was never seen.
+ */
+int symbol_find(const char *const name);
+
+/**
+ * @returns The name registered for the given slot, or NULL.
+ */
+const char *symbol_name(int slot);
+
+/**
+ * @returns The number of registered symbols. Slots are [0, count).
+ */
+int symbol_count(void);
+
+#endif
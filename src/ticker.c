@@ -0,0 +1,185 @@
+#ifdef CAIRO
+
+#include "ticker.h"
+#include "cairo_draw_text.h"
+#include "symbols.h"
+#include "options.h"
+#include "log.h"
+#include <cairo/cairo.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+// space between two symbols before scaling, in pixels
+#define TICKER_GAP 24
+
+typedef struct {
+    char text[64];
+    rgba_color color;
+    bool dirty;
+
+    // pre-rendered text, TICKER_HEIGHT high
+    cairo_surface_t *surface;
+    int width;
+    float scale;
+} ticker_entry_t;
+
+static ticker_entry_t *entries[SYMBOLS_MAX];
+static double offset = 0;
+
+// what the last ticker_draw() showed, to skip frames that would repeat it
+static bool changed = true;
+static int drawn_x = 0;
+static float drawn_scale = 0;
+
+bool ticker_update(const char *const symbol, const char *const text, rgba_color color)
+{
+    int slot = symbol_slot(symbol);
+    if (slot < 0) {
+        return false;
+    }
+
+    ticker_entry_t *e = entries[slot];
+    if (!e) {
+        e = entries[slot] = calloc(1, sizeof(ticker_entry_t));
+        if (!e) {
+            __error__("Cannot allocate ticker entry for %s\n", symbol);
+            return false;
+        }
+    } else if (strcmp(e->text, text) == 0 && memcmp(&e->color, &color, sizeof(color)) == 0) {
+        return false;
+    }
+
+    bool pending = e->dirty;
+    strncpy(e->text, text, sizeof(e->text) - 1);
+    e->color = color;
+    e->dirty = true;
+    changed = true;
+    return pending;
+}
+
+void ticker_remove(const char *const symbol)
+{
+    int slot = symbol_find(symbol);
+    if (slot < 0 || !entries[slot]) {
+        return;
+    }
+
+    if (entries[slot]->surface) {
+        cairo_surface_destroy(entries[slot]->surface);
+    }
+    free(entries[slot]);
+    entries[slot] = NULL;
+    changed = true;
+}
+
+void ticker_invalidate(void)
+{
+    int count = symbol_count();
+    for (int i = 0; i < count; i++) {
+        if (entries[i]) {
+            entries[i]->dirty = true;
+        }
+    }
+    changed = true;
+}
+
+bool ticker_pending(void)
+{
+    return changed || drawn_scale != options.scale;
+}
+
+bool ticker_scroll(double seconds)
+{
+    offset += options.ticker_speed * options.scale * seconds;
+    return ticker_pending() || (int)offset != drawn_x;
+}
+
+static void render_entry(ticker_entry_t *e)
+{
+    __debug__("Rendering ticker entry \"%s\"\n", e->text);
+
+    // the title font of the overlay, resolved once for all entries
+    text_renderer_t *renderer = text_renderer_current();
+    if (!renderer) {
+        return;
+    }
+    cairo_scaled_font_t *font = text_renderer_title_font(renderer, true);
+
+    // measure first, the surface is sized to the text
+    cairo_text_extents_t extents;
+    cairo_scaled_font_text_extents(font, e->text, &extents);
+
+    if (e->surface) {
+        cairo_surface_destroy(e->surface);
+    }
+    e->scale = options.scale;
+    e->width = (int)extents.x_advance + 1 + TICKER_GAP * options.scale;
+    e->surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, e->width, TICKER_HEIGHT * options.scale);
+
+    cairo_t *cr = cairo_create(e->surface);
+    cairo_set_scaled_font(cr, font);
+    cairo_set_source_rgba(cr, e->color.r, e->color.g, e->color.b, e->color.a);
+    cairo_move_to(cr, 0, 30 * options.scale);
+    cairo_show_text(cr, e->text);
+    cairo_destroy(cr);
+
+    cairo_surface_flush(e->surface);
+    e->dirty = false;
+}
+
+void ticker_draw(cairo_t *const cr, int width)
+{
+    int count = symbol_count();
+    double total = 0;
+    for (int i = 0; i < count; i++) {
+        ticker_entry_t *e = entries[i];
+        if (!e) {
+            continue;
+        }
+        if (e->dirty || e->scale != options.scale) {
+            render_entry(e);
+        }
+        total += e->width;
+    }
+
+    cairo_save(cr);
+    cairo_set_operator(cr, CAIRO_OPERATOR_SOURCE);
+
+    changed = false;
+    drawn_scale = options.scale;
+
+    if (total == 0) {
+        cairo_rectangle(cr, 0, 0, width, TICKER_HEIGHT * options.scale);
+        cairo_set_source_rgba(cr, 0, 0, 0, 0);
+        cairo_fill(cr);
+        cairo_restore(cr);
+        drawn_x = (int)offset;
+        return;
+    }
+
+    // wrap the offset without pulling in libm
+    offset -= (long)(offset / total) * total;
+    drawn_x = (int)offset;
+
+    // walk the tape from the scroll offset until the strip is covered,
+    // wrapping around as often as needed when the tape is short; whole
+    // pixel positions keep the blits plain copies without resampling
+    int x = -(int)offset;
+    for (int i = 0; x < width; i = (i + 1) % count) {
+        ticker_entry_t *e = entries[i];
+        if (!e) {
+            continue;
+        }
+        if (x + e->width > 0) {
+            cairo_set_source_surface(cr, e->surface, x, 0);
+            cairo_rectangle(cr, x, 0, e->width, TICKER_HEIGHT * options.scale);
+            cairo_fill(cr);
+        }
+        x += e->width;
+    }
+
+    cairo_restore(cr);
+}
+
+#endif
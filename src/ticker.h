@@ -0,0 +1,72 @@
+#ifndef INCLUDE_TICKER_H
+#define INCLUDE_TICKER_H
+
+#include <stdbool.h>
+#include <cairo/cairo.h>
+#include "color.h"
+
+/**
+ * Frame rate of the ticker tape where the backend has to pace frames itself.
+ */
+#define TICKER_FPS 60
+
+/**
+ * Height of the ticker strip before scaling, in pixels.
+ */
+#define TICKER_HEIGHT 40
+
+/**
+ * Sets the text shown for a symbol on the ticker tape.
+ *
+ * The text is pre-rendered into a small per-symbol surface on the next
+ * frame, and only if it or the color actually changed.
+ *
+ * @param symbol The symbol name.
+ * @param text   The text to show, e.g. "ES1 5012.25 +12.50".
+ * @param color  The text color.
+ *
+ * @returns true if this replaced a text that was never drawn.
+ */
+bool ticker_update(const char *const symbol, const char *const text, rgba_color color);
+
+/**
+ * Removes a symbol from the ticker tape.
+ *
+ * @param symbol The symbol name.
+ */
+void ticker_remove(const char *const symbol);
+
+/**
+ * Re-renders all entries on the next frame, e.g. after the font changed.
+ */
+void ticker_invalidate(void);
+
+/**
+ * @returns true if an entry was added, removed or changed, or the scale
+ *          changed, since the last ticker_draw().
+ */
+bool ticker_pending(void);
+
+/**
+ * Advances the tape by `options.ticker_speed' pixels per second.
+ *
+ * @param seconds Time elapsed since the previous frame.
+ *
+ * @returns true if ticker_draw() would now show something else than it
+ *          last did: the tape moved by a whole pixel, or ticker_pending().
+ */
+bool ticker_scroll(double seconds);
+
+/**
+ * Draws the visible part of the tape at the current scroll offset.
+ *
+ * Each visible symbol is a single blit of its cached surface. The strip is
+ * drawn with CAIRO_OPERATOR_SOURCE, so every pixel of it is written once and
+ * the target does not have to be cleared between frames.
+ *
+ * @param cr    The cairo context to draw into.
+ * @param width Width of the target in pixels.
+ */
+void ticker_draw(cairo_t *const cr, int width);
+
+#endif
@@ -7,17 +7,26 @@
 #include <string.h>
 #include <time.h>
 #include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
 #include <sys/mman.h>
 #include <wayland-client.h>
 
 #include <cairo/cairo.h>
 
 #include "wlr-layer-shell-unstable-v1.h"
+#include "fractional-scale-v1.h"
+#include "viewporter.h"
 
 #include "wayland.h"
+#include "../animation.h"
 #include "../cairo_draw_text.h"
+#include "../control.h"
+#include "../ticker.h"
 #include "../options.h"
 #include "../log.h"
+#include "../sparkline.h"
+#include "../stock.h"
 
 #define UNUSED(expr) do { (void)(expr); } while (0)
 
@@ -27,20 +36,67 @@ struct state {
     struct wl_compositor *compositor;
     struct wl_shm *shm;
     struct zwlr_layer_shell_v1 *layer_shell;
+    // optional, for redrawing the parts of the static overlay on their own
+    struct wl_subcompositor *subcompositor;
+    // optional, for rendering at fractional scales
+    struct wp_fractional_scale_manager_v1 *fractional_scale_manager;
+    struct wp_viewporter *viewporter;
 
     struct wl_list outputs;
 };
 
+struct output;
+
+// a shm buffer and the cairo surface drawing into it, kept until its size
+// changes; the compositor holds it from attach until it is released
+struct buffer {
+    struct output *output;
+    struct wl_buffer *wl_buffer;
+    void *data;
+    size_t size;
+    cairo_surface_t *surface;
+    int width, height;
+    bool busy;
+};
+
+// each surface alternates between these, one may be held by the compositor
+#define BUFFERS 2
+
+// a part of the static overlay on its own desynchronized subsurface, so
+// that an update only redraws, uploads and re-textures that part
+struct region {
+    struct wl_surface *surface;
+    struct wl_subsurface *subsurface;
+    struct wp_viewport *viewport;
+    struct buffer buffers[BUFFERS];
+    // position and size on the layer surface
+    int32_t y, height;
+    // hash of what the attached buffer shows
+    uint64_t key;
+};
+
 struct output {
     struct wl_list link;
     struct state *state;
 
     int32_t scale;
+    // preferred scale of the surface in 120ths, 0 if not announced
+    uint32_t preferred_scale;
     uint32_t wl_name;
 
     struct wl_output *wl_output;
     struct wl_surface *surface;
     struct zwlr_layer_surface_v1 *layer_surface;
+    struct wl_callback *frame_callback;
+    struct wp_fractional_scale_v1 *fractional_scale;
+    struct wp_viewport *viewport;
+    struct buffer buffers[BUFFERS];
+    struct region regions[TEXT_REGIONS];
+    // pixel size of the transparent buffer under the regions, 0 if none
+    int backdrop_width, backdrop_height;
+    // a frame was skipped because the compositor held all buffers, it is
+    // drawn once one is released
+    bool starved;
 
     // dimensions of the layer_surface, not the output
     uint32_t width, height;
@@ -79,70 +135,368 @@ static int anonymous_shm_open(void)
     return -1;
 }
 
-// renders a frame then commits
-static void frame_commit(struct output *output)
+static void frame_commit(struct output *output);
+
+// compositor time of the last ticker frame, shared by all outputs
+static uint32_t last_frame_time = 0;
+
+// the compositor is ready for the next frame: scroll the tape and redraw
+static void frame_done(void *data, struct wl_callback *callback, uint32_t time)
 {
-    if (output->width == 0 || output->height == 0) {
-        return;
+    struct output *output = data;
+
+    wl_callback_destroy(callback);
+    output->frame_callback = NULL;
+
+    if (last_frame_time != 0 && time > last_frame_time) {
+        ticker_scroll((time - last_frame_time) / 1000.0);
     }
+    last_frame_time = time;
+
+    frame_commit(output);
+}
 
-    __debug__("Rendering a wayland frame\n");
+static const struct wl_callback_listener frame_listener = {
+    .done = frame_done,
+};
 
-    int width = output->width * options.scale * output->scale;
-    int height = output->height * options.scale * output->scale;
+static void buffer_release(void *data, struct wl_buffer *wl_buffer)
+{
+    UNUSED(wl_buffer);
+    struct buffer *buffer = data;
+    buffer->busy = false;
 
-    int32_t stride = width * 4;
-    size_t size = stride * height;
+    struct output *output = buffer->output;
+    if (output->starved) {
+        output->starved = false;
+        frame_commit(output);
+    }
+}
 
+static const struct wl_buffer_listener buffer_listener = {
+    .release = buffer_release,
+};
+
+static void buffer_free(struct buffer *buffer)
+{
+    if (!buffer->wl_buffer) {
+        return;
+    }
+    cairo_surface_destroy(buffer->surface);
+    wl_buffer_destroy(buffer->wl_buffer);
+    munmap(buffer->data, buffer->size);
+    memset(buffer, 0, sizeof(*buffer));
+}
+
+// a buffer of the given size that the compositor does not hold, reusing
+// one of the pool if it can; NULL if it holds them all, the frame is then
+// drawn on the next release
+static struct buffer *buffer_get(struct output *output, struct buffer buffers[BUFFERS],
+                                 int width, int height)
+{
+    struct buffer *buffer = NULL;
+    for (int i = 0; i < BUFFERS; i++) {
+        if (buffers[i].busy) {
+            continue;
+        }
+        buffer = &buffers[i];
+        if (buffer->wl_buffer && buffer->width == width && buffer->height == height) {
+            return buffer;
+        }
+    }
+    if (!buffer) {
+        // writing to or unmapping a held buffer would tear what is shown
+        output->starved = true;
+        return NULL;
+    }
+    buffer_free(buffer);
+
+    int32_t stride = width * 4;
+    size_t size = (size_t)stride * height;
     int fd = anonymous_shm_open();
-    switch(ftruncate(fd, size)) {
-    case EINTR:
-        __error__("! Signal caught during frame rendering.\n");
-        break;
-    case EINVAL:
-        __error__("! Can't truncate to negative length.\n");
-        break;
-    case EFBIG:
-        __error__("! Length is bigger than the allowed value.\n");
-        break;
-    case EIO:
-        __error__("! I/O error during frame rendering.\n");
-        break;
-    case EBADF:
-        __error__("! ftruncate called with bad FD.\n");
-        break;
+    if (fd < 0 || ftruncate(fd, size) < 0) {
+        __perror__("Cannot allocate a wayland buffer");
+        if (fd >= 0) {
+            close(fd);
+        }
+        return NULL;
     }
     void *data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (data == MAP_FAILED) {
+        __perror__("Cannot map a wayland buffer");
+        close(fd);
+        return NULL;
+    }
     struct wl_shm_pool *pool = wl_shm_create_pool(output->state->shm, fd, size);
-    struct wl_buffer *buffer = wl_shm_pool_create_buffer(pool, 0,
-                               width, height, stride, WL_SHM_FORMAT_ARGB8888);
+    buffer->wl_buffer = wl_shm_pool_create_buffer(pool, 0, width, height, stride,
+                                                  WL_SHM_FORMAT_ARGB8888);
     wl_shm_pool_destroy(pool);
     close(fd);
+    wl_buffer_add_listener(buffer->wl_buffer, &buffer_listener, buffer);
+
+    buffer->output = output;
+    buffer->data = data;
+    buffer->size = size;
+    buffer->surface = cairo_image_surface_create_for_data(data, CAIRO_FORMAT_ARGB32,
+                                                          width, height, stride);
+    buffer->width = width;
+    buffer->height = height;
+    return buffer;
+}
 
-    cairo_surface_t *surface = cairo_image_surface_create_for_data(data,
-                               CAIRO_FORMAT_ARGB32, width, height, stride);
-    cairo_t *cairo = cairo_create(surface);
+// the buffers have exactly the pixels of the surfaces on the output: with
+// a fractional scale the viewports map them back to the surface size,
+// otherwise the buffer scale does. Untested on a compositor so far, as the
+// backend is not started, see wayland_backend_start()
+static double buffer_scale(const struct output *output)
+{
+    if (output->preferred_scale && output->viewport) {
+        return output->preferred_scale / 120.0;
+    }
+    return output->scale;
+}
 
-    float orig_scale = options.scale;
-    options.scale *= output->scale;
-    draw_text(cairo, 0);
-    options.scale = orig_scale;
+// attaches a buffer covering width x height of the surface, to be committed
+static void surface_attach(const struct output *output, struct wl_surface *surface,
+                           struct wp_viewport *viewport, struct buffer *buffer,
+                           int32_t width, int32_t height)
+{
+    if (output->preferred_scale && viewport) {
+        wl_surface_set_buffer_scale(surface, 1);
+        wp_viewport_set_destination(viewport, width, height);
+    } else {
+        wl_surface_set_buffer_scale(surface, output->scale);
+    }
+    wl_surface_attach(surface, buffer->wl_buffer, 0, 0);
+    wl_surface_damage_buffer(surface, 0, 0, INT32_MAX, INT32_MAX);
+    buffer->busy = true;
+}
+
+// the ticker tape and flashes are paced by the compositor's frame
+// callbacks, which stop once nothing moves
+static void frame_request(struct output *output, struct wl_surface *surface)
+{
+    if ((options.display_mode == DISPLAY_TICKER || animation_running()) && !output->frame_callback) {
+        output->frame_callback = wl_surface_frame(surface);
+        wl_callback_add_listener(output->frame_callback, &frame_listener, output);
+    }
+}
+
+static uint64_t hash_bytes(uint64_t hash, const void *data, size_t size)
+{
+    const unsigned char *p = data;
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ p[i]) * 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+static uint64_t hash_string(uint64_t hash, const char *s)
+{
+    return s ? hash_bytes(hash, s, strlen(s) + 1) : hash_bytes(hash, "", 1);
+}
+
+// what a region would show if drawn now, at the scale in `options'
+static uint64_t region_key(text_region_t region, int width, int height)
+{
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    hash = hash_bytes(hash, &region, sizeof(region));
+    hash = hash_bytes(hash, &width, sizeof(width));
+    hash = hash_bytes(hash, &height, sizeof(height));
+    hash = hash_bytes(hash, &options.scale, sizeof(options.scale));
+    hash = hash_bytes(hash, &options.text_color, sizeof(options.text_color));
+    hash = hash_string(hash, options.custom_font);
+    hash = hash_bytes(hash, &options.bold_mode, sizeof(options.bold_mode));
+    hash = hash_bytes(hash, &options.italic_mode, sizeof(options.italic_mode));
+    if (region == TEXT_REGION_TITLE) {
+        return hash_string(hash, options.title);
+    }
+    hash = hash_string(hash, options.subtitle);
+    if (options.sparkline_hours > 0) {
+        // the newest point of the line follows the price
+        hash = hash_string(hash, sparkline_selected());
+        hash = hash_string(hash, options.title);
+    }
+    return hash;
+}
+
+static bool region_create(struct output *output, struct region *region)
+{
+    struct state *state = output->state;
+    region->surface = wl_compositor_create_surface(state->compositor);
+
+    struct wl_region *input_region = wl_compositor_create_region(state->compositor);
+    wl_surface_set_input_region(region->surface, input_region);
+    wl_region_destroy(input_region);
+
+    region->subsurface = wl_subcompositor_get_subsurface(state->subcompositor,
+                                                         region->surface, output->surface);
+    if (!region->subsurface) {
+        wl_surface_destroy(region->surface);
+        region->surface = NULL;
+        return false;
+    }
+    // commits show up right away, without waiting for the layer surface
+    wl_subsurface_set_desync(region->subsurface);
+    if (output->viewport) {
+        region->viewport = wp_viewporter_get_viewport(state->viewporter, region->surface);
+    }
+    region->y = -1;
+    return true;
+}
+
+static void region_destroy(struct region *region)
+{
+    for (int i = 0; i < BUFFERS; i++) {
+        buffer_free(&region->buffers[i]);
+    }
+    if (region->viewport) {
+        wp_viewport_destroy(region->viewport);
+    }
+    if (region->subsurface) {
+        wl_subsurface_destroy(region->subsurface);
+    }
+    if (region->surface) {
+        wl_surface_destroy(region->surface);
+    }
+    memset(region, 0, sizeof(*region));
+}
 
-    wl_surface_set_buffer_scale(output->surface, output->scale);
-    wl_surface_attach(output->surface, buffer, 0, 0);
-    wl_surface_damage_buffer(output->surface, 0, 0, INT32_MAX, INT32_MAX);
+// redraws and commits the regions whose content changed; `split' is where
+// the subtitle region starts on the layer surface
+static void regions_commit(struct output *output, double scale, int32_t split)
+{
+    bool moved = false;
+    for (int i = 0; i < TEXT_REGIONS; i++) {
+        struct region *region = &output->regions[i];
+        if (!region->surface && !region_create(output, region)) {
+            continue;
+        }
+        int32_t y = i == TEXT_REGION_TITLE ? 0 : split;
+        int32_t height = i == TEXT_REGION_TITLE ? split : (int32_t)output->height - split;
+        if (region->y != y) {
+            // takes effect with the next commit of the layer surface
+            wl_subsurface_set_position(region->subsurface, 0, y);
+            region->y = y;
+            moved = true;
+        }
+        region->height = height;
+        if (height <= 0) {
+            continue;
+        }
+
+        int width = output->width * scale + 0.5;
+        int pixels = height * scale + 0.5;
+        uint64_t key = region_key(i, width, pixels);
+        if (key == region->key) {
+            continue;
+        }
+        struct buffer *buffer = buffer_get(output, region->buffers, width, pixels);
+        if (!buffer) {
+            continue;
+        }
+
+        __debug__("Rendering wayland region %d\n", i);
+        cairo_t *cairo = cairo_create(buffer->surface);
+        cairo_translate(cairo, 0, -(int)(y * scale + 0.5));
+        draw_text_region(cairo, i);
+        cairo_destroy(cairo);
+        cairo_surface_flush(buffer->surface);
+
+        surface_attach(output, region->surface, region->viewport, buffer, output->width, height);
+        frame_request(output, region->surface);
+        wl_surface_commit(region->surface);
+        region->key = key;
+    }
+
+    // the layer surface itself only shows a transparent buffer under the
+    // regions, attached again when its size changes
+    int width = output->width * scale + 0.5;
+    int height = output->height * scale + 0.5;
+    if (!moved && output->backdrop_width == width && output->backdrop_height == height) {
+        return;
+    }
+    struct buffer *buffer = buffer_get(output, output->buffers, width, height);
+    if (!buffer) {
+        return;
+    }
+    memset(buffer->data, 0, buffer->size);
+    surface_attach(output, output->surface, output->viewport, buffer, output->width, output->height);
     wl_surface_commit(output->surface);
+    output->backdrop_width = width;
+    output->backdrop_height = height;
+}
 
-    cairo_destroy(cairo);
-    cairo_surface_destroy(surface);
-    wl_buffer_destroy(buffer);
-    munmap(data, size);
+// renders a frame then commits
+static void frame_commit(struct output *output)
+{
+    if (output->width == 0 || output->height == 0) {
+        return;
+    }
+
+    double scale = buffer_scale(output);
+    // the static overlay is split in regions where the compositor can
+    // place subsurfaces; the tape and the rotation change as a whole
+    bool regions = output->state->subcompositor && options.display_mode == DISPLAY_STATIC;
+    int32_t split = TEXT_SUBTITLE_TOP * options.scale + 0.5;
+    if (split > (int32_t)output->height) {
+        split = output->height;
+    }
+
+    double started = animation_clock();
+    stock_animate();
+    float orig_scale = options.scale;
+    options.scale *= scale;
+
+    if (regions) {
+        regions_commit(output, scale, split);
+        // a fade keeps its frames coming even if no region changed
+        if (animation_running() && !output->frame_callback) {
+            frame_request(output, output->surface);
+            wl_surface_commit(output->surface);
+        }
+    } else {
+        __debug__("Rendering a wayland frame\n");
+        int width = output->width * scale + 0.5;
+        int height = output->height * scale + 0.5;
+        struct buffer *buffer = buffer_get(output, output->buffers, width, height);
+        if (buffer) {
+            cairo_t *cairo = cairo_create(buffer->surface);
+            draw_text(cairo, 0);
+            cairo_destroy(cairo);
+            cairo_surface_flush(buffer->surface);
+
+            surface_attach(output, output->surface, output->viewport, buffer,
+                           output->width, output->height);
+            frame_request(output, output->surface);
+            wl_surface_commit(output->surface);
+        }
+    }
+
+    options.scale = orig_scale;
+    animation_frame_done(animation_clock() - started);
 }
 
 static void output_destroy(struct output *output)
 {
     __debug__("Destroying output\n");
 
+    if (output->frame_callback) {
+        wl_callback_destroy(output->frame_callback);
+    }
+    // subsurfaces go before the surface they are placed on
+    for (int i = 0; i < TEXT_REGIONS; i++) {
+        region_destroy(&output->regions[i]);
+    }
+    for (int i = 0; i < BUFFERS; i++) {
+        buffer_free(&output->buffers[i]);
+    }
+    if (output->fractional_scale) {
+        wp_fractional_scale_v1_destroy(output->fractional_scale);
+    }
+    if (output->viewport) {
+        wp_viewport_destroy(output->viewport);
+    }
     if (output->layer_surface) {
         zwlr_layer_surface_v1_destroy(output->layer_surface);
     }
@@ -190,6 +544,23 @@ static const struct zwlr_layer_surface_v1_listener layer_surface_listener = {
     .closed = layer_surface_closed,
 };
 
+static void fractional_scale_preferred(void *data,
+                                       struct wp_fractional_scale_v1 *fractional_scale, uint32_t scale)
+{
+    UNUSED(fractional_scale);
+    struct output *output = data;
+
+    __debug__("Preferred wayland surface scale %.3f\n", scale / 120.0);
+    if (output->preferred_scale != scale) {
+        output->preferred_scale = scale;
+        frame_commit(output);
+    }
+}
+
+static const struct wp_fractional_scale_v1_listener fractional_scale_listener = {
+    .preferred_scale = fractional_scale_preferred,
+};
+
 static void output_geometry(void *data, struct wl_output *output, int32_t x,
                             int32_t y, int32_t width_mm, int32_t height_mm, int32_t subpixel,
                             const char *make, const char *model, int32_t transform)
@@ -232,6 +603,16 @@ static void output_done(void *data, struct wl_output *wl_output)
         wl_surface_set_input_region(output->surface, input_region);
         wl_region_destroy(input_region);
 
+        // both or neither, a fractional scale needs the viewport to map
+        // the buffer to the surface
+        if (output->state->fractional_scale_manager && output->state->viewporter) {
+            output->fractional_scale = wp_fractional_scale_manager_v1_get_fractional_scale(
+                                           output->state->fractional_scale_manager, output->surface);
+            wp_fractional_scale_v1_add_listener(output->fractional_scale,
+                                                &fractional_scale_listener, output);
+            output->viewport = wp_viewporter_get_viewport(output->state->viewporter, output->surface);
+        }
+
         output->layer_surface = zwlr_layer_shell_v1_get_layer_surface(
                                     output->state->layer_shell, output->surface, output->wl_output,
                                     ZWLR_LAYER_SHELL_V1_LAYER_OVERLAY, "activate notification");
@@ -285,13 +666,23 @@ static void handle_global(void *data, struct wl_registry *registry,
     } else if (strcmp(interface, wl_output_interface.name) == 0) {
         struct output *output = calloc(1, sizeof(struct output));
         output->state = state;
+        // the default until the output announces its scale
+        output->scale = 1;
         output->wl_name = name;
         output->wl_output = wl_registry_bind(registry, name, &wl_output_interface, 2);
         wl_output_add_listener(output->wl_output, &output_listener, output);
         wl_list_insert(&state->outputs, &output->link);
+    } else if (strcmp(interface, wl_subcompositor_interface.name) == 0) {
+        state->subcompositor =
+            wl_registry_bind(registry, name, &wl_subcompositor_interface, 1);
     } else if (strcmp(interface, zwlr_layer_shell_v1_interface.name) == 0) {
         state->layer_shell =
             wl_registry_bind(registry, name, &zwlr_layer_shell_v1_interface, 1);
+    } else if (strcmp(interface, wp_fractional_scale_manager_v1_interface.name) == 0) {
+        state->fractional_scale_manager =
+            wl_registry_bind(registry, name, &wp_fractional_scale_manager_v1_interface, 1);
+    } else if (strcmp(interface, wp_viewporter_interface.name) == 0) {
+        state->viewporter = wl_registry_bind(registry, name, &wp_viewporter_interface, 1);
     }
 }
 
@@ -315,6 +706,9 @@ static const struct wl_registry_listener registry_listener = {
     .global_remove = handle_global_remove,
 };
 
+// Not started by main() yet: this loop only dispatches Wayland events and
+// has no quote feed, so the static overlay shows its initial text and the
+// subsurface regions are groundwork until the feed is wired in here.
 int wayland_backend_start(void)
 {
     struct state state = {0};
@@ -346,6 +740,5 @@ int wayland_backend_start(void)
 }
 
 int wayland_backend_kill_running(void) {
-    __error__("wayland_backend_kill_running currently is not implemented\n");
-    return 1;
+    return control_command("quit");
 }
@@ -2,7 +2,6 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#define __USE_XOPEN     // for strptime
 #include <time.h>
 #include <unistd.h>
 
@@ -10,41 +9,31 @@
 #include <X11/Xatom.h>
 #include <X11/Xlib.h>
 #include <X11/extensions/Xfixes.h>
-#include <X11/extensions/Xinerama.h>
 #include <X11/extensions/Xrandr.h>
 #include <X11/extensions/shape.h>
 
 #include <cairo/cairo-xlib.h>
 #include <cairo/cairo.h>
 
-#include <hiredis/hiredis.h>
 #include <errno.h>
+#include <pthread.h>
+#include <sys/select.h>
 
+#include "../animation.h"
 #include "../cairo_draw_text.h"
+#include "../control.h"
+#include "../board.h"
 #include "../log.h"
 #include "../options.h"
-
-// Structure to hold parsed stock data
-typedef struct {
-    char fmttime[32];
-    double time;
-    double open;
-    double high;
-    double low;
-    double close;
-    long volume;
-    double percent_change;
-    double change;
-    char symbol[16];
-    int updated;
-    char title[64];
-    char subtitle[64];
-} stock_data_t;
-
-// Global variables for Redis
-stock_data_t current_stock_data = {0};
-time_t most_recent = 0;
-redisContext *redis_ctx = NULL;
+#include "../redis.h"
+#include "../startup.h"
+#include "../stock.h"
+#include "../ticker.h"
+#include "../rotation.h"
+#include "../routes.h"
+#ifdef LIBCONFIG
+  #include "../config.h"
+#endif
 
 // generated function: returns XEvent name
 const char *XEventName(int type);
@@ -57,243 +46,418 @@ static bool compositor_check(Display *d, int screen)
     return XGetSelectionOwner(d, prop_atom) != None;
 }
 
-// -- beginning of added Redis support
-// Function to parse semicolon-separated stock data string
-int parse_stock_data(const char* data_str, stock_data_t* stock_data) {
-    if (!data_str || !stock_data) {
-        return -1;
+static double monotonic_seconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// One overlay per monitor it is shown on, with everything needed to draw it
+typedef struct {
+    // the monitor; its name identifies it across configuration changes
+    Atom name;
+    int x, y, width, height;
+    // the symbols routed to the monitor by the `outputs' config setting,
+    // -1 to show all
+    int route;
+    // still matched to a monitor while the overlays are updated
+    bool seen;
+
+    Window window;
+    Pixmap frame;
+    cairo_surface_t *surface;
+    cairo_t *cairo_ctx;
+
+    // only without a compositor
+    Pixmap xshape_mask;
+    cairo_surface_t *xshape_surface;
+    cairo_t *xshape_ctx;
+} overlay_t;
+
+// The pool grows as monitors are added. Entries are kept while their
+// monitor only moves or resizes, and reused for another monitor when theirs
+// went away, e.g. when docking a laptop
+static overlay_t *overlays = NULL;
+static int overlay_count = 0;
+static int overlay_capacity = 0;
+
+// what creating overlays needs, set up once the display is open
+static Display *d = NULL;
+static Window root;
+static XVisualInfo vinfo;
+static XSetWindowAttributes attrs;
+static bool compositor_running;
+static int overlay_width, overlay_height;
+
+// Overlays are drawn into a pixmap that is also their window background:
+// the server repairs exposed parts from it on its own, and a new frame is
+// shown by clearing the window to its background
+static void present_overlay(overlay_t *o)
+{
+    cairo_surface_flush(o->surface);
+    XClearWindow(d, o->window);
+}
+
+// Draws the text of an overlay: the symbols routed to its monitor, or the
+// newest of all; routes only apply to the static display
+static void draw_overlay_text(overlay_t *o, cairo_t *cr, int xshape_mask)
+{
+    if (o->route >= 0 && options.display_mode == DISPLAY_STATIC) {
+        routes_draw(cr, o->route, xshape_mask);
+    } else {
+        draw_text(cr, xshape_mask);
     }
+}
 
-    // Create a copy of the string for strtok
-    char* data_copy = strdup(data_str);
-    if (!data_copy) {
-        return -1;
+// Fully redraws an overlay; without a compositor the XShape mask is redrawn
+// and applied too
+static void draw_overlay(overlay_t *o)
+{
+    if (!compositor_running)
+    {
+        __debug__("Shaping window using XShape\n");
+        draw_overlay_text(o, o->cairo_ctx, 2);
+        draw_overlay_text(o, o->xshape_ctx, 1);
+        XShapeCombineMask(d, o->window, ShapeBounding, 0, 0,
+                          cairo_xlib_surface_get_drawable(o->xshape_surface), ShapeSet);
+    } else {
+        draw_overlay_text(o, o->cairo_ctx, 0);
     }
+    present_overlay(o);
+}
 
-    char* token;
-    int field_count = 0;
-
-    // Parse each field separated by semicolon, see the repo
-    // https://github.com/eddelbuettel/redis-pubsub-example
-    // for a sample producer (and a simpler consumer)
-    token = strtok(data_copy, ";");
-    while (token && field_count < 8) {
-        switch (field_count) {
-            case 0: // formatted time
-                memcpy(stock_data->fmttime, token, strlen(token));
-                break;
-            case 1: // open
-                stock_data->open = atof(token);
-                break;
-            case 2: // high
-                stock_data->high = atof(token);
-                break;
-            case 3: // low
-                stock_data->low = atof(token);
-                break;
-            case 4: // close
-                stock_data->close = atof(token);
-                break;
-            case 5: // volume
-                stock_data->volume = atol(token);
-                break;
-            case 6: // change
-                stock_data->change = atof(token);
-                break;
-            case 7: // percent_change
-                stock_data->percent_change = atof(token);
-                break;
-        }
-        field_count++;
-        token = strtok(NULL, ";");
+// Puts the overlay into the bottom right corner of its monitor
+static void place_overlay(overlay_t *o)
+{
+    XMoveResizeWindow(d, o->window, o->x + o->width - overlay_width, o->y + o->height - overlay_height,
+                      overlay_width, overlay_height);
+}
+
+static void create_frame(overlay_t *o)
+{
+    o->frame = XCreatePixmap(d, o->window, overlay_width, overlay_height, vinfo.depth);
+    XSetWindowBackgroundPixmap(d, o->window, o->frame);
+    if (!compositor_running)
+    {
+        o->xshape_mask = XCreatePixmap(d, o->window, overlay_width, overlay_height, 1);
+        o->xshape_surface = cairo_xlib_surface_create_for_bitmap(d, o->xshape_mask, DefaultScreenOfDisplay(d),
+                                                                 overlay_width, overlay_height);
+        o->xshape_ctx = cairo_create(o->xshape_surface);
     }
+}
 
-    free(data_copy);
+static void free_frame(overlay_t *o)
+{
+    XFreePixmap(d, o->frame);
+    if (!compositor_running)
+    {
+        cairo_destroy(o->xshape_ctx);
+        cairo_surface_destroy(o->xshape_surface);
+        XFreePixmap(d, o->xshape_mask);
+    }
+}
 
-    struct tm tm;
-    strptime(stock_data->fmttime, "%Y-%m-%d %H:%M:%S", &tm);
-    stock_data->time = mktime(&tm);
-    if (stock_data->time > most_recent) {
-        stock_data->updated = 1;
-        most_recent = stock_data->time;
-        __info__("Seeing updated data for %s at %s\n", stock_data->symbol, stock_data->fmttime);
-    } else {
-        stock_data->updated = 0;
+static void create_overlay(overlay_t *o)
+{
+    __debug__("Creating overlay at %dx%d+%d+%d\n", o->width, o->height, o->x, o->y);
+    o->window = XCreateWindow(d,                                                             // display
+                              root,                                                          // parent
+                              o->x + o->width - overlay_width,                               // x position
+                              o->y + o->height - overlay_height,                             // y position
+                              overlay_width,                                                 // width
+                              overlay_height,                                                // height
+                              0,                                                             // border width
+                              vinfo.depth,                                                   // depth
+                              InputOutput,                                                   // class
+                              vinfo.visual,                                                  // visual
+                              CWOverrideRedirect | CWColormap | CWBackPixel | CWBorderPixel, // value mask
+                              &attrs                                                         // attributes
+    );
+    // the server repaints exposed parts from the background pixmap, the
+    // Expose events only tell when the overlay was first shown
+    XSelectInput(d, o->window, ExposureMask);
+
+    // allows the mouse to click through the overlay
+    XRectangle rect;
+    XserverRegion region = XFixesCreateRegion(d, &rect, 1);
+    XFixesSetWindowShapeRegion(d, o->window, ShapeInput, 0, 0, region);
+    XFixesDestroyRegion(d, region);
+
+    // sets a WM_CLASS to allow the user to blacklist some effect from compositor
+    XClassHint *xch = XAllocClassHint();
+    xch->res_name = "activate-linux";
+    xch->res_class = "activate-linux";
+    XSetClassHint(d, o->window, xch);
+    XFree(xch);
+
+    // set _NET_WM_BYPASS_COMPOSITOR
+    // https://specifications.freedesktop.org/wm-spec/wm-spec-latest.html#idm45446104333040
+    if (options.bypass_compositor)
+    {
+        __debug__("Bypassing compositor\n");
+        unsigned char data = 1;
+        XChangeProperty(d, o->window, XInternAtom(d, "_NET_WM_BYPASS_COMPOSITOR", False), XA_CARDINAL, 32,
+                        PropModeReplace, &data, 1);
+    }
+
+    if (options.gamescope_overlay)
+    {
+        // https://github.com/Plagman/gamescope/issues/288
+        // https://github.com/flightlessmango/MangoHud/blob/9a6809daca63cf6860ac9d92ae4b2dde36239b0e/src/app/main.cpp#L47
+        // https://github.com/flightlessmango/MangoHud/blob/9a6809daca63cf6860ac9d92ae4b2dde36239b0e/src/app/main.cpp#L189
+        // https://github.com/trigg/Discover/blob/de83063f3452b1cdee89b4c3779103eae2c90cbb/discover_overlay/overlay.py#L107
+
+        __debug__("Setting GAMESCOPE_EXTERNAL_OVERLAY\n");
+        unsigned char data = 1;
+        XChangeProperty(d, o->window, XInternAtom(d, "GAMESCOPE_EXTERNAL_OVERLAY", False), XA_CARDINAL, 32,
+                        PropModeReplace, &data, 1);
     }
-    
-    __info__("Field count %d\n", field_count);
-    return (field_count == 8) ? 0 : -1;
+
+    __debug__("Creating cairo context and, without a compositor, the XShape mask\n");
+    create_frame(o);
+    o->surface = cairo_xlib_surface_create(d, o->frame, vinfo.visual, overlay_width, overlay_height);
+    o->cairo_ctx = cairo_create(o->surface);
+
+    // the first frame is in place before the window is shown
+    draw_overlay(o);
+    control_stats.frames++;
+    XMapWindow(d, o->window);
 }
 
-void assign_rgb_colors(double chg, float cols[9][3]) {
-    int p = chg / 0.250;        // truncating division used on purpose here
-    //p = (p > 8) ? 8 : p; 	// so that we don't need fmin() and hence -lm linking */
-    p = (p > 7) ? 7 : p; 	// the extreme one is too dark on the dark terminal
-    options.text_color = rgba_color_new(cols[p][0], cols[p][1], cols[p][2], 0.6);
+// The overlay size changed, e.g. with the scale in a reloaded config file
+static void resize_overlay(overlay_t *o)
+{
+    place_overlay(o);
+    free_frame(o);
+    create_frame(o);
+    cairo_xlib_surface_set_drawable(o->surface, o->frame, overlay_width, overlay_height);
 }
 
-void set_rgb_colors(double chg) {
-    // these are from ColorBrewer and are the red and green four valued multi-hue
-    // values, divided by 255 to fit the [0, 1) range here
-    // see
-    //   RColorBrewer::display.brewer.pal(9, "Reds")
-    // use
-    //   M <- col2rgb(RColorBrewer::brewer.pal(9, "Reds"))/255
-    //   for (i in 1:9) cat("{ ", paste(sprintf("%.8f",M[,i]), collapse=", "), "},\n")
-    float reds[9][3] = {
-        {  1.00000000, 0.96078431, 0.94117647 },
-        {  0.99607843, 0.87843137, 0.82352941 },
-        {  0.98823529, 0.73333333, 0.63137255 },
-        {  0.98823529, 0.57254902, 0.44705882 },
-        {  0.98431373, 0.41568627, 0.29019608 },
-        {  0.93725490, 0.23137255, 0.17254902 },
-        {  0.79607843, 0.09411765, 0.11372549 },
-        {  0.64705882, 0.05882353, 0.08235294 },
-        {  0.40392157, 0.00000000, 0.05098039 }
-    };
-    // see
-    //   RColorBrewer::display.brewer.pal(9, "Greens")
-    // use
-    //   M <- col2rgb(RColorBrewer::brewer.pal(9, "Greens"))/255
-    //   for (i in 1:9) cat("{ ", paste(sprintf("%.8f",M[,i]), collapse=", "), "},\n")
-    float greens[9][3] = {
-        {  0.96862745, 0.98823529, 0.96078431 },
-        {  0.89803922, 0.96078431, 0.87843137 },
-        {  0.78039216, 0.91372549, 0.75294118 },
-        {  0.63137255, 0.85098039, 0.60784314 },
-        {  0.45490196, 0.76862745, 0.46274510 },
-        {  0.25490196, 0.67058824, 0.36470588 },
-        {  0.13725490, 0.54509804, 0.27058824 },
-        {  0.00000000, 0.42745098, 0.17254902 },
-        {  0.00000000, 0.26666667, 0.10588235 }
-    };
-    if (chg < 0)
-        assign_rgb_colors(-chg, reds);
-    else
-        assign_rgb_colors(chg, greens);
+static void destroy_overlay(overlay_t *o)
+{
+    __debug__("Destroying overlay at %dx%d+%d+%d\n", o->width, o->height, o->x, o->y);
+    cairo_destroy(o->cairo_ctx);
+    cairo_surface_destroy(o->surface);
+    free_frame(o);
+    XDestroyWindow(d, o->window);
 }
 
-// Function to format stock data and time into activate-linux fields
-void draw_stock_data() {
-    sprintf(current_stock_data.title, "%.2f %+.2f %+.3f%%",
-            current_stock_data.close,
-            current_stock_data.change,
-            current_stock_data.percent_change);
-    sprintf(current_stock_data.subtitle, "%s @ %s",
-            current_stock_data.symbol,
-            current_stock_data.fmttime);
-    options.title = current_stock_data.title;
-    options.subtitle = current_stock_data.subtitle;
-    set_rgb_colors(current_stock_data.percent_change);
+// Whether `options.monitors' asks for an overlay on a monitor: "primary"
+// is the primary monitor or, if none is, the first one, "all" is every
+// monitor, and anything else a comma separated list of monitor names
+static bool monitor_selected(const XRRMonitorInfo *const m, bool first, bool have_primary)
+{
+    const char *monitors = options.monitors ? options.monitors : "primary";
+    if (strcmp(monitors, "all") == 0) {
+        return true;
+    }
+    if (strcmp(monitors, "primary") == 0) {
+        return have_primary ? m->primary : first;
+    }
+
+    char *name = XGetAtomName(d, m->name);
+    if (!name) {
+        return false;
+    }
+    size_t len = strlen(name);
+    bool found = false;
+    for (const char *p = monitors; *p && !found; p += strcspn(p, ",") + (p[strcspn(p, ",")] == ',')) {
+        found = strcspn(p, ",") == len && strncmp(p, name, len) == 0;
+    }
+    XFree(name);
+    return found;
 }
 
-// Function to handle Redis pub/sub messages
-int handle_redis_messages() {
-    redisReply *reply;
+// The route of a monitor, looked up by its name
+static int monitor_route(Atom name)
+{
+    char *output = XGetAtomName(d, name);
+    if (!output) {
+        return -1;
+    }
+    int route = routes_find(output);
+    XFree(output);
+    return route;
+}
 
-    // Use redisGetReply to read the next reply
-    if (redisGetReply(redis_ctx, (void**)&reply) != REDIS_OK) {
-        if (redis_ctx->err) {
-            printf("Redis error: %s\n", redis_ctx->errstr);
-            return -1;
+static overlay_t *find_overlay(Atom name)
+{
+    for (int i = 0; i < overlay_count; i++) {
+        if (overlays[i].name == name) {
+            return &overlays[i];
         }
-        return 0; // No data available
     }
+    return NULL;
+}
+
+// Matches the overlays to the monitors as they are now. Windows are only
+// created for added monitors and destroyed for removed ones
+static void update_overlays(void)
+{
+    int count = 0;
+    XRRMonitorInfo *monitors = XRRGetMonitors(d, root, True, &count);
+    bool have_primary = false;
+    for (int i = 0; i < count; i++) {
+        have_primary |= monitors[i].primary;
+    }
+    __debug__("Found %d monitor(s)\n", count);
 
-    if (!reply) {
-        return 0;
+    for (int i = 0; i < overlay_count; i++) {
+        overlays[i].seen = false;
+    }
+    bool wanted[count > 0 ? count : 1];
+    for (int i = 0; i < count; i++) {
+        wanted[i] = monitor_selected(&monitors[i], i == 0, have_primary);
+        overlay_t *o = wanted[i] ? find_overlay(monitors[i].name) : NULL;
+        if (o) {
+            o->seen = true;
+            wanted[i] = false;
+        }
     }
 
-    if (reply->type == REDIS_REPLY_ARRAY && reply->elements >= 3) {
-        char* message_type = reply->element[0]->str;
-        char* channel = reply->element[1]->str;
-        char* message = reply->element[2]->str;
-
-        __info__("Redis message - Type: %s, Channel: %s, Data: %s\n", message_type, channel, message);
-
-        if (strcmp(message_type, "message") == 0) {
-            // Parse and update stock data
-            strncpy(current_stock_data.symbol, channel,
-                    sizeof(current_stock_data.symbol) - 1);
-            current_stock_data.symbol[sizeof(current_stock_data.symbol) - 1] = '\0';
-
-            if (parse_stock_data(message, &current_stock_data) == 0) {
-                if (current_stock_data.updated == 1) {
-                    __info__("Stock data updated for %s to %s\n", channel, message);
-                    draw_stock_data();
-                } else {
-                    __info__("Ignoring message %s:%s\n", channel, message);
-                }
-            } else {
-                printf("Error parsing stock data: %s\n", message);
+    for (int i = 0; i < count; i++) {
+        XRRMonitorInfo *m = &monitors[i];
+        overlay_t *o = find_overlay(m->name);
+        if (!wanted[i]) {
+            if (o && o->seen && (o->x != m->x || o->y != m->y || o->width != m->width || o->height != m->height)) {
+                __debug__("Moving overlay to the new position of its monitor\n");
+                o->x = m->x;
+                o->y = m->y;
+                o->width = m->width;
+                o->height = m->height;
+                place_overlay(o);
             }
-        } else if (strcmp(message_type, "subscribe") == 0) {
-            printf("Successfully subscribed to channel: %s\n", channel);
+            continue;
         }
-    } else {
-        printf("Unexpected reply type: %d\n", reply->type);
+
+        // an overlay whose monitor went away moves over
+        o = NULL;
+        for (int j = 0; j < overlay_count && !o; j++) {
+            o = overlays[j].seen ? NULL : &overlays[j];
+        }
+        if (!o && overlay_count == overlay_capacity) {
+            int capacity = overlay_capacity ? 2 * overlay_capacity : 4;
+            overlay_t *grown = realloc(overlays, capacity * sizeof(overlay_t));
+            if (!grown) {
+                __error__("Cannot add an overlay for another monitor\n");
+                break;
+            }
+            overlays = grown;
+            overlay_capacity = capacity;
+        }
+        bool reused = o != NULL;
+        if (!o) {
+            o = &overlays[overlay_count++];
+        }
+        o->name = m->name;
+        o->route = monitor_route(m->name);
+        o->x = m->x;
+        o->y = m->y;
+        o->width = m->width;
+        o->height = m->height;
+        o->seen = true;
+        if (reused) {
+            __debug__("Moving overlay to another monitor\n");
+            place_overlay(o);
+            // which may be routed other symbols
+            draw_overlay(o);
+        } else {
+            create_overlay(o);
+        }
+    }
+
+    // the last entry fills the gap of a removed one
+    for (int i = 0; i < overlay_count;) {
+        if (overlays[i].seen) {
+            i++;
+            continue;
+        }
+        destroy_overlay(&overlays[i]);
+        overlays[i] = overlays[--overlay_count];
+    }
+
+    if (monitors) {
+        XRRFreeMonitors(monitors);
     }
+}
 
-    freeReplyObject(reply);
-    return 1;
+static void destroy_overlays(void)
+{
+    for (int i = 0; i < overlay_count; i++) {
+        destroy_overlay(&overlays[i]);
+    }
+    free(overlays);
+    overlays = NULL;
+    overlay_count = overlay_capacity = 0;
 }
 
-// -- end of added Redis support
+// Quotes come either from our own Redis subscription, or from the board of
+// the instance owning it. They are set up on a thread of their own, so that
+// connecting overlaps opening the display and creating the overlays.
+static int feed_fd = -1;
+static pthread_t feed_thread;
+static bool feed_threaded = false;
 
-int x11_backend_start(void)
+static void *feed_start(void *arg)
 {
-    // init_redis_subscription START
-    const char* symbols[] = { "SP500", "ES1" };
-    const char* host = "127.0.0.1";
-    int port = 6379;
-    struct timeval timeout = { 1, 500000 }; // 1.5 seconds
-
-    if (options.host != NULL)
-        host = options.host;
-
-    redis_ctx = redisConnectWithTimeout(host, port, timeout);
-    if (!redis_ctx || redis_ctx->err) {
-        if (redis_ctx) {
-            printf("Error: %s\n", redis_ctx->errstr);
-            redisFree(redis_ctx);
-        } else {
-            printf("Error: Can't allocate redis context\n");
+    (void)arg;
+    if (options.board_mode == BOARD_ATTACH) {
+        feed_fd = board_attach();
+    } else if (redis_start() == 0) {
+        feed_fd = redis_fd();
+        if (options.board_mode == BOARD_PUBLISH && board_publish_start() != 0) {
+            redis_stop();
+            feed_fd = -1;
         }
-        return -1;
     }
+    startup_trace("quote feed ready");
+    return NULL;
+}
 
-    __info__("Connected to Redis server %s:%d\n", host, port);
-
-    for (size_t i = 0; i < sizeof(symbols) / sizeof(symbols[0]); i++) {
-        const char* symbol = symbols[i];
+// Waits for feed_start(), returns the descriptor to wait on or -1
+static int feed_wait(void)
+{
+    if (feed_threaded) {
+        pthread_join(feed_thread, NULL);
+        feed_threaded = false;
+    }
+    return feed_fd;
+}
 
-        // Subscribe to the symbol
-        redisReply *reply = redisCommand(redis_ctx, "SUBSCRIBE %s", symbol);
-        if (!reply) {
-            printf("Error: Failed to subscribe to %s\n", symbol);
-            return -1;
-        }
+static void feed_stop(void)
+{
+    feed_wait();
+    board_stop();
+    redis_stop();
+}
 
-        __info__("Subscribed to symbol: %s\n", symbol);
 
-        // Handle subscription confirmation
-        if (reply->type == REDIS_REPLY_ARRAY && reply->elements >= 3) {
-            __debug__("Subscription confirmed for: %s\n", reply->element[1]->str);
-        }
+int x11_backend_start(void)
+{
+    int control_fd = control_start();
 
-        freeReplyObject(reply);
+    feed_threaded = pthread_create(&feed_thread, NULL, feed_start, NULL) == 0;
+    if (!feed_threaded) {
+        feed_start(NULL);
     }
-    // init_redis_subscription END
 
     __debug__("Opening display\n");
-    Display *d = XOpenDisplay(NULL);
+    d = XOpenDisplay(NULL);
+    if (d == NULL) {
+        __error__("Cannot open display\n");
+        feed_stop();
+        control_stop(control_fd);
+        return 1;
+    }
+    startup_trace("display opened");
     __debug__("Finding root window\n");
-    Window root = DefaultRootWindow(d);
+    root = DefaultRootWindow(d);
     __debug__("Finding default screen\n");
     int default_screen = XDefaultScreen(d);
 
     __debug__("Checking compositor\n");
-    bool compositor_running = compositor_check(d, XDefaultScreen(d));
+    compositor_running = compositor_check(d, XDefaultScreen(d));
     if (!compositor_running)
     {
         __info__("No running compositor detected. Program may not work as intended\n");
@@ -302,40 +466,28 @@ int x11_backend_start(void)
 		__debug__("Forcing XShape\n");
 		compositor_running = false;
 	}
-    // https://x.org/releases/current/doc/man/man3/Xinerama.3.xhtml
-    __debug__("Finding all screens in use using Xinerama\n");
-    int num_entries = 0, screen_map[] = {1, 0}; // DEdd: map governs which screen gets display, see below
-    XineramaScreenInfo *si = XineramaQueryScreens(d, &num_entries);
-    // if xinerama fails
-    if (si == NULL)
-    {
-        __perror__(
-            "Required X extension Xinerama is not active. It is needed for displaying watermark on multiple screens");
-        XCloseDisplay(d);
-        return 1;
-    }
-    __debug__("Found %d screen(s)\n", num_entries);
 
     // https://cgit.freedesktop.org/xorg/proto/randrproto/tree/randrproto.txt
     __debug__("Initializing Xrandr\n");
     int xrr_error_base;
     int xrr_event_base;
-    if (!XRRQueryExtension(d, &xrr_event_base, &xrr_error_base))
+    int xrr_major = 0, xrr_minor = 0;
+    if (!XRRQueryExtension(d, &xrr_event_base, &xrr_error_base) || !XRRQueryVersion(d, &xrr_major, &xrr_minor) ||
+        xrr_major < 1 || (xrr_major == 1 && xrr_minor < 5))
     {
-        __perror__("Required X extension Xrandr is not active. It is needed for handling screen size change (e.g. in "
-                   "virtual machine window)");
-        XFree(si);
+        __perror__("Required X extension Xrandr 1.5 is not active. It is needed for finding the monitors and "
+                   "following their changes (e.g. when docking)");
         XCloseDisplay(d);
+        feed_stop();
+        control_stop(control_fd);
         return 1;
     }
-    __debug__("Subscribing on screen change events\n");
-    XRRSelectInput(d, root, RRScreenChangeNotifyMask);
+    __debug__("Subscribing on screen and monitor change events\n");
+    XRRSelectInput(d, root, RRScreenChangeNotifyMask | RRCrtcChangeNotifyMask | RROutputChangeNotifyMask);
+    startup_trace("screens queried");
 
-    XSetWindowAttributes attrs;
     attrs.override_redirect = 1;
 
-    XVisualInfo vinfo;
-
     // MacOS doesn't support 32 bit color through XQuartz, massive hack
 #ifdef __APPLE__
     int colorDepth = 24;
@@ -351,117 +503,89 @@ int x11_backend_start(void)
     }
 
     __debug__("Set %d bit color depth\n", colorDepth);
+    startup_trace("visual matched");
     attrs.colormap = XCreateColormap(d, root, vinfo.visual, AllocNone);
     attrs.background_pixel = 0;
     attrs.border_pixel = 0;
 
-    Window overlay[num_entries];
-    cairo_surface_t *surface[num_entries];
-    cairo_t *cairo_ctx[num_entries];
-
-    Pixmap xshape_mask[num_entries];
-    cairo_surface_t *xshape_surface[num_entries];
-    cairo_t *xshape_ctx[num_entries];
-
-    int overlay_height = options.overlay_height * options.scale;
+    overlay_height = options.overlay_height * options.scale;
     __debug__("Scaled height: %d px\n", overlay_height);
-    int overlay_width = options.overlay_width * options.scale;
+    overlay_width = options.overlay_width * options.scale;
     __debug__("Scaled width:  %d px\n", overlay_width);
 
-    for (int i = 0; i < num_entries; i++)
-    {
-        if (screen_map[i] == 0) continue;
-
-        __debug__("Creating overlay on %d screen\n", i);
-        overlay[i] = XCreateWindow(d,                                                                // display
-                                   root,                                                             // parent
-                                   si[i].x_org + si[i].width - overlay_width,  // x position
-                                   si[i].y_org + si[i].height - overlay_height, // y position
-                                   overlay_width,                                                    // width
-                                   overlay_height,                                                   // height
-                                   0,                                                                // border width
-                                   vinfo.depth,                                                      // depth
-                                   InputOutput,                                                      // class
-                                   vinfo.visual,                                                     // visual
-                                   CWOverrideRedirect | CWColormap | CWBackPixel | CWBorderPixel,    // value mask
-                                   &attrs                                                            // attributes
-        );
-        // subscribe to Exposure Events, required for redrawing after DPMS blanking
-        XSelectInput(d, overlay[i], ExposureMask);
-        XMapWindow(d, overlay[i]);
-
-        // allows the mouse to click through the overlay
-        XRectangle rect;
-        XserverRegion region = XFixesCreateRegion(d, &rect, 1);
-        XFixesSetWindowShapeRegion(d, overlay[i], ShapeInput, 0, 0, region);
-        XFixesDestroyRegion(d, region);
-
-        // sets a WM_CLASS to allow the user to blacklist some effect from compositor
-        XClassHint *xch = XAllocClassHint();
-        xch->res_name = "activate-linux";
-        xch->res_class = "activate-linux";
-        XSetClassHint(d, overlay[i], xch);
-
-        // set _NET_WM_BYPASS_COMPOSITOR
-        // https://specifications.freedesktop.org/wm-spec/wm-spec-latest.html#idm45446104333040
-        if (options.bypass_compositor)
-        {
-            __debug__("Bypassing compositor\n");
-            unsigned char data = 1;
-            XChangeProperty(d, overlay[i], XInternAtom(d, "_NET_WM_BYPASS_COMPOSITOR", False), XA_CARDINAL, 32,
-                            PropModeReplace, &data, 1);
-        }
-
-        if (options.gamescope_overlay)
-        {
-            // https://github.com/Plagman/gamescope/issues/288
-            // https://github.com/flightlessmango/MangoHud/blob/9a6809daca63cf6860ac9d92ae4b2dde36239b0e/src/app/main.cpp#L47
-            // https://github.com/flightlessmango/MangoHud/blob/9a6809daca63cf6860ac9d92ae4b2dde36239b0e/src/app/main.cpp#L189
-            // https://github.com/trigg/Discover/blob/de83063f3452b1cdee89b4c3779103eae2c90cbb/discover_overlay/overlay.py#L107
-
-            __debug__("Setting GAMESCOPE_EXTERNAL_OVERLAY\n");
-            unsigned char data = 1;
-            XChangeProperty(d, overlay[i], XInternAtom(d, "GAMESCOPE_EXTERNAL_OVERLAY", False), XA_CARDINAL, 32,
-                            PropModeReplace, &data, 1);
-        }
+    update_overlays();
+    startup_trace("overlays created");
 
-        __debug__("Creating cairo context\n");
-        surface[i] = cairo_xlib_surface_create(d, overlay[i], vinfo.visual, overlay_width, overlay_height);
-        cairo_ctx[i] = cairo_create(surface[i]);
-
-        __debug__("Creating cario surface/context and mask pixmap for XShape support\n");
-        if (!compositor_running)
-        {
-            xshape_mask[i] = XCreatePixmap(d, overlay[i], overlay_width, overlay_height, 1);
-            xshape_surface[i] = cairo_xlib_surface_create_for_bitmap(d, xshape_mask[i], DefaultScreenOfDisplay(d),
-                                                                     overlay_width, overlay_height);
-            xshape_ctx[i] = cairo_create(xshape_surface[i]);
-        }
-    }
+    // the overlays are mapped, their first Expose may already be waiting
+    // while the feed finishes
+    bool running = feed_wait() >= 0;
+    startup_trace("quote feed joined");
 
     __info__("All done. Going into X windows event endless loop\n\n");
     XEvent event;
-    // init_redis_subscription START
     fd_set read_fds;
+    struct timeval timeout;
     int x11_fd = ConnectionNumber(d);
-    int redis_fd = redis_ctx->fd;
-    int max_fd = (x11_fd > redis_fd) ? x11_fd : redis_fd;
-    //struct timeval timeout;
-    // init_redis_subscription END
-
-    while (1)
+    int max_fd = (x11_fd > feed_fd) ? x11_fd : feed_fd;
+    max_fd = (control_fd > max_fd) ? control_fd : max_fd;
+#ifdef LIBCONFIG
+    int config_fd = config_watch();
+    max_fd = (config_fd > max_fd) ? config_fd : max_fd;
+#endif
+    // wakes the loop for animation frames, and only while something animates
+    int animation_fd = animation_timer();
+    max_fd = (animation_fd > max_fd) ? animation_fd : max_fd;
+    double frame_interval = 1.0 / TICKER_FPS;
+    double last_frame = monotonic_seconds();
+    double last_rotation = last_frame;
+    bool painted = false, quoted = false;
+    bool monitors_changed = false;
+
+    while (running)
     {
         // Prepare file descriptor set
         FD_ZERO(&read_fds);
         FD_SET(x11_fd, &read_fds);
-        FD_SET(redis_fd, &read_fds);
+        FD_SET(feed_fd, &read_fds);
+        if (control_fd >= 0) {
+            FD_SET(control_fd, &read_fds);
+        }
+#ifdef LIBCONFIG
+        if (config_fd >= 0) {
+            FD_SET(config_fd, &read_fds);
+        }
+#endif
+        if (animation_fd >= 0) {
+            animation_timer_arm(animation_fd);
+            FD_SET(animation_fd, &read_fds);
+        }
 
-        // Set timeout for select (100ms)
-        timeout.tv_sec = 0;
-        timeout.tv_usec = 100000;
+        // Sleep until the next ticker frame, rotation or animation frame is
+        // due, or else until something arrives; the static display, and a
+        // ticker tape that does not scroll, are idle between quotes
+        double wait = -1;
+        bool paced = false;
+        if (options.display_mode == DISPLAY_TICKER && (options.ticker_speed != 0 || ticker_pending())) {
+            wait = last_frame + frame_interval - monotonic_seconds();
+            paced = true;
+        } else if (options.display_mode == DISPLAY_ROTATE) {
+            wait = last_rotation + options.rotate_interval - monotonic_seconds();
+            paced = true;
+        }
+        wait = (wait < 0 && paced) ? 0 : wait;
+        double animation_due = animation_fd < 0 ? animation_wait() : -1;
+        if (animation_due >= 0 && (wait < 0 || animation_due < wait)) {
+            wait = animation_due;
+        }
+        // events Xlib already read do not wake select
+        if (XEventsQueued(d, QueuedAlready) > 0) {
+            wait = 0;
+        }
+        timeout.tv_sec = wait;
+        timeout.tv_usec = (wait - timeout.tv_sec) * 1e6;
 
         __debug__("Before select in endless loop\n");
-        int ready = select(max_fd + 1, &read_fds, NULL, NULL, &timeout);
+        int ready = select(max_fd + 1, &read_fds, NULL, NULL, wait < 0 ? NULL : &timeout);
         __debug__("After select in endless loop\n");
 
         if (ready < 0) {
@@ -472,25 +596,153 @@ int x11_backend_start(void)
             break;
         }
 
-        // Handle Redis messages
-        if (ready > 0 && FD_ISSET(redis_fd, &read_fds)) {
-            // Process all available Redis messages
-            //while (handle_redis_messages() > 0) {
-            handle_redis_messages();
-                // Keep processing until no more messages
-            //}
-            __info__("Text now set, num_entries %d\n", num_entries);
-            for (int i = 0; i < num_entries; i++) {
-                if (screen_map[i] == 1) {
-                    __info__("Showing in screen %d\n", i);
-                    draw_text(cairo_ctx[i], 0);
+        // Handle Redis messages, or quote board changes
+        if (ready > 0 && FD_ISSET(feed_fd, &read_fds)) {
+            if (options.board_mode == BOARD_ATTACH) {
+                board_poll();
+            } else {
+                // Process all available Redis messages
+                handle_redis_messages();
+            }
+        }
+        if (ready > 0 && animation_fd >= 0 && FD_ISSET(animation_fd, &read_fds)) {
+            animation_timer_read(animation_fd);
+        }
+
+        // Draw the overlays with new quotes and, in the same frame, those
+        // whose symbol flashes if an animation frame is due. The ticker tape
+        // picks up new values with its next frame, and overlays routed other
+        // symbols than those quoted are left alone
+        if (options.display_mode != DISPLAY_TICKER) {
+            bool animate = animation_wait() == 0;
+            double started = animation_clock();
+            bool flashing = stock_animate();
+            bool drawn = false;
+            for (int i = 0; i < overlay_count; i++) {
+                overlay_t *o = &overlays[i];
+                bool routed = o->route >= 0 && options.display_mode == DISPLAY_STATIC;
+                bool dirty = routed ? routes_take(o->route) || (animate && routes_animating(o->route))
+                                    : needs_redraw || (animate && flashing);
+                if (dirty) {
+                    __info__("Showing in overlay %d\n", i);
+                    draw_overlay(o);
+                    drawn = true;
+                }
+            }
+            needs_redraw = 0;
+            if (drawn) {
+                control_stats.frames++;
+                XFlush(d);
+                if (!quoted) {
+                    quoted = true;
+                    startup_trace("first quote drawn");
+                }
+            }
+            // a due frame with nothing to draw still moves the schedule on
+            if (drawn || animate) {
+                animation_frame_done(animation_clock() - started);
+            }
+        }
+
+#ifdef LIBCONFIG
+        // Apply a changed config file without reconnecting; only what differs
+        // from the previous options is redone
+        if (ready > 0 && config_fd >= 0 && FD_ISSET(config_fd, &read_fds) &&
+            config_changed(config_fd)) {
+            Options previous;
+            if (reload_config(&previous) == 0) {
+                redis_update_subscriptions(&previous);
+
+                bool font_changed = strcmp(previous.custom_font, options.custom_font) != 0 ||
+                                    previous.bold_mode != options.bold_mode ||
+                                    previous.italic_mode != options.italic_mode;
+                bool size_changed = previous.scale != options.scale ||
+                                    previous.overlay_width != options.overlay_width ||
+                                    previous.overlay_height != options.overlay_height;
+                // ticker entries and rotation frames notice a new scale themselves
+                if (font_changed) {
+                    ticker_invalidate();
+                }
+                if (font_changed || size_changed) {
+                    rotation_invalidate();
+                }
+
+                if (size_changed) {
+                    overlay_width = options.overlay_width * options.scale;
+                    overlay_height = options.overlay_height * options.scale;
+                    __debug__("Resizing overlays to %dx%d px\n", overlay_width, overlay_height);
+                }
+                // overlays for monitors it no longer names go away, and
+                // come for the ones it now does
+                bool monitors_selected = (previous.monitors == NULL) != (options.monitors == NULL) ||
+                                         (options.monitors && strcmp(previous.monitors, options.monitors) != 0);
+                if (monitors_selected) {
+                    update_overlays();
+                }
+                for (int i = 0; i < overlay_count; i++) {
+                    if (size_changed) {
+                        resize_overlay(&overlays[i]);
+                    }
+                    // the `outputs' setting may route it other symbols
+                    overlays[i].route = monitor_route(overlays[i].name);
+                    // paint the new look right away instead of waiting for the next quote
+                    draw_overlay(&overlays[i]);
+                }
+                control_stats.frames++;
+                XFlush(d);
+            }
+        }
+#endif
+
+        // Show the next symbol; unchanged symbols are a blit from the frame cache
+        if (options.display_mode == DISPLAY_ROTATE) {
+            double now = monotonic_seconds();
+            if (now - last_rotation >= options.rotate_interval) {
+                last_rotation = now;
+                if (rotation_next()) {
+                    control_stats.frames++;
+                    for (int i = 0; i < overlay_count; i++) {
+                        draw_overlay(&overlays[i]);
+                    }
+                    XFlush(d);
+                }
+            }
+        }
+
+        // Scroll the ticker tape; frames are plain blits of cached surfaces,
+        // and skipped when the tape did not move by a pixel and no entry changed
+        if (options.display_mode == DISPLAY_TICKER) {
+            double now = monotonic_seconds();
+            if (now - last_frame >= frame_interval) {
+                bool moved = ticker_scroll(now - last_frame);
+                last_frame = now;
+                if (moved) {
+                    control_stats.frames++;
+                    for (int i = 0; i < overlay_count; i++) {
+                        overlay_t *o = &overlays[i];
+                        ticker_draw(o->cairo_ctx, overlay_width);
+                        present_overlay(o);
+                        if (!compositor_running) {
+                            ticker_draw(o->xshape_ctx, overlay_width);
+                            XShapeCombineMask(d, o->window, ShapeBounding, 0, 0,
+                                              cairo_xlib_surface_get_drawable(o->xshape_surface), ShapeSet);
+                        }
+                    }
+                    XFlush(d);
                 }
             }
         }
 
+        // Answer control requests, `quit' ends the loop like a Redis error
+        if (ready > 0 && control_fd >= 0 && FD_ISSET(control_fd, &read_fds) &&
+            control_handle(control_fd)) {
+            __info__("Quitting on control request\n");
+            break;
+        }
+
         // Check for Redis connection errors
-        if (redis_ctx->err) {
-            printf("Redis connection error: %s\n", redis_ctx->errstr);
+        if (redis_error()) {
+            printf("Redis connection error: %s\n", redis_error());
             break;
         }
 
@@ -506,17 +758,7 @@ int x11_backend_start(void)
                     if (event.type - xrr_event_base == RRScreenChangeNotify)
                         {
                             __debug__("! Got Xrandr event about screen change\n");
-                            __debug__("  Updating info about screen sizes\n");
-                            si = XineramaQueryScreens(d, &num_entries);
-                            for (int i = 0; i < num_entries; i++)
-                                {
-                                    __debug__("  Moving window on screen %d according new position\n", i);
-                                    XMoveWindow(d,                                                               // display
-                                                overlay[i],                                                      // window
-                                                si[i].x_org + si[i].width - overlay_width, // x position
-                                                si[i].y_org + si[i].height - overlay_height // y position
-                                        );
-                                }
+                            monitors_changed = true;
                         }
                     else
                         {
@@ -524,68 +766,53 @@ int x11_backend_start(void)
                                       event.type - xrr_event_base);
                         }
                 }
+            else if (event.type == xrr_event_base + RRNotify)
+                {
+                    // an output or CRTC changed without the screen size changing
+                    __debug__("! Got Xrandr event about output change\n");
+                    monitors_changed = true;
+                }
             else if (event.type == Expose)
                 {
                     /*
                      * See https://www.x.org/releases/X11R7.5/doc/man/man3/XExposeEvent.3.html
-                     * removed draw_text() call from elsewhere because XExposeEvent is emitted
-                     * on both window init and window damage.
+                     * XExposeEvent is emitted on both window init and window damage, e.g.
+                     * after DPMS blanking. The server already repainted the exposed parts
+                     * from the background pixmap, and the XShape mask stays in place.
                      */
 
                     __debug__("! Got X event, type: %s (0x%X)\n", XEventName(event.type), event.type);
-                    for (int i = 0; i < num_entries && event.xexpose.count == 0; i++)
-                        {
-                            if (overlay[i] == event.xexpose.window)
-                                {
-                                    __debug__("  Redrawing overlay: %d\n", i);
-
-                                    if (!compositor_running)
-                                        {
-                                            __debug__("Shaping window %d using XShape\n", i);
-                                            draw_text(cairo_ctx[i], 2);
-                                            draw_text(xshape_ctx[i], 1);
-                                            XShapeCombineMask(d, overlay[i], ShapeBounding, 0, 0,
-                                                              cairo_xlib_surface_get_drawable(xshape_surface[i]), ShapeSet);
-                                        } else {
-                                        draw_text(cairo_ctx[i], 0);
-                                    }
-                                    break;
-                                }
-                        }
+                    if (!painted && event.xexpose.count == 0) {
+                        painted = true;
+                        startup_trace("first paint");
+                    }
                 }
             else
                 {
                     __debug__("! Got X event, type: %s (0x%X)\n", XEventName(event.type), event.type);
                 }
         }
-    }
-
-    // free used resources
-    for (int i = 0; i < num_entries; i++)
-    {
-        XUnmapWindow(d, overlay[i]);
-        cairo_destroy(cairo_ctx[i]);
-        cairo_surface_destroy(surface[i]);
-    }
 
-    if (!compositor_running)
-    {
-  	  for (int i = 0; i < num_entries; i++)
-   	  {
-    	    XFreePixmap(d, xshape_mask[i]);
-            cairo_destroy(xshape_ctx[i]);
-            cairo_surface_destroy(xshape_surface[i]);
-	  }
+        // a dock or a monitor being switched sends a burst of events, the
+        // overlays are matched to the monitors once it was read
+        if (monitors_changed) {
+            monitors_changed = false;
+            __debug__("  Updating overlays to the monitors\n");
+            update_overlays();
+            XFlush(d);
+        }
     }
 
-    XFree(si);
+    // free used resources
+    destroy_overlays();
     XCloseDisplay(d);
+    feed_stop();
+    control_stop(control_fd);
 
-    return 0;
+    return running ? 0 : -1;
 }
 
 int x11_backend_kill_running(void)
 {
-    __error__("x11_backend_kill_running currently is not implemented\n");
-    return 1;
+    return control_command("quit");
 }